@@ -0,0 +1,127 @@
+#ifndef BUFFER_POOL_HXX
+#define BUFFER_POOL_HXX
+
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <array>
+#include <vector>
+
+// hands out uninitialized buffers in a few size classes. released buffers go to a free list of the releasing thread
+// so the hot path never touches a lock or the global allocator
+class Buffer_pool {
+public:
+	class Buffer {
+	public:
+		Buffer() = default;
+		Buffer(const Buffer & rhs) = delete;
+		Buffer(Buffer && rhs) noexcept;
+		Buffer & operator=(const Buffer & rhs) = delete;
+		Buffer & operator=(Buffer && rhs) noexcept;
+		~Buffer();
+
+		char * data() noexcept;
+		const char * data() const noexcept;
+		std::size_t size() const noexcept;
+		std::size_t capacity() const noexcept;
+		bool empty() const noexcept;
+		// contents past the old size are left uninitialized
+		void resize(std::size_t new_size) noexcept;
+		void clear() noexcept;
+		void append(std::string_view content) noexcept;
+		void swap(Buffer & rhs) noexcept;
+
+	private:
+		friend class Buffer_pool;
+
+		Buffer(char * storage, std::size_t capacity) noexcept;
+		void reset() noexcept;
+		///
+		char * m_storage = nullptr;
+		std::size_t m_size = 0;
+		std::size_t m_capacity = 0;
+	};
+
+	static Buffer acquire(std::size_t min_capacity) noexcept;
+	// the capacity acquire would hand out for min_capacity
+	static std::size_t capacity_for(std::size_t min_capacity) noexcept;
+	static std::uint64_t hits() noexcept;
+	static std::uint64_t misses() noexcept;
+
+private:
+	constexpr static std::array<std::size_t, 6> size_classes{512, 2 * 1024, 8 * 1024, 16 * 1024, 64 * 1024, 256 * 1024};
+	constexpr static std::size_t max_cached_per_class = 256;
+
+	struct Free_lists {
+		Free_lists();
+		Free_lists(const Free_lists & rhs) = delete;
+		Free_lists & operator=(const Free_lists & rhs) = delete;
+		~Free_lists();
+
+		std::array<std::vector<char *>, size_classes.size()> lists;
+	};
+
+	static void release(char * storage, std::size_t capacity) noexcept;
+	static std::size_t size_class_index(std::size_t capacity) noexcept;
+	static Free_lists & local_free_lists() noexcept;
+	///
+	inline static std::atomic_uint64_t m_hits = 0;
+	inline static std::atomic_uint64_t m_misses = 0;
+};
+
+inline Buffer_pool::Buffer::Buffer(char * const storage, const std::size_t capacity) noexcept : m_storage(storage), m_capacity(capacity) {
+}
+
+inline Buffer_pool::Buffer::Buffer(Buffer && rhs) noexcept {
+	swap(rhs);
+}
+
+inline Buffer_pool::Buffer & Buffer_pool::Buffer::operator=(Buffer && rhs) noexcept {
+	Buffer(std::move(rhs)).swap(*this);
+	return *this;
+}
+
+inline Buffer_pool::Buffer::~Buffer() {
+	reset();
+}
+
+inline char * Buffer_pool::Buffer::data() noexcept {
+	return m_storage;
+}
+
+inline const char * Buffer_pool::Buffer::data() const noexcept {
+	return m_storage;
+}
+
+inline std::size_t Buffer_pool::Buffer::size() const noexcept {
+	return m_size;
+}
+
+inline std::size_t Buffer_pool::Buffer::capacity() const noexcept {
+	return m_capacity;
+}
+
+inline bool Buffer_pool::Buffer::empty() const noexcept {
+	return !m_size;
+}
+
+inline void Buffer_pool::Buffer::clear() noexcept {
+	m_size = 0;
+}
+
+inline void Buffer_pool::Buffer::swap(Buffer & rhs) noexcept {
+	std::swap(m_storage, rhs.m_storage);
+	std::swap(m_size, rhs.m_size);
+	std::swap(m_capacity, rhs.m_capacity);
+}
+
+inline std::uint64_t Buffer_pool::hits() noexcept {
+	return m_hits.load(std::memory_order_relaxed);
+}
+
+inline std::uint64_t Buffer_pool::misses() noexcept {
+	return m_misses.load(std::memory_order_relaxed);
+}
+
+#endif // BUFFER_POOL_HXX
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef COROUTINE_SESSION_HXX
+#define COROUTINE_SESSION_HXX
+
+#include "session.h"
+
+#include <asio/detail/config.hpp>
+
+// only with a c++20 build. see TCPSERVER_COROUTINES
+#if defined(ASIO_HAS_CO_AWAIT)
+
+#include <asio/awaitable.hpp>
+#include <asio/use_awaitable.hpp>
+#include <asio/ssl/context.hpp>
+#include <string_view>
+#include <cstdint>
+
+class Tcp_server;
+
+// the whole connection as one coroutine whose reads and writes take turns. asio::ssl and plaintext on the reactor only
+class Coroutine_session {
+public:
+	using strand_type = Session::strand_type;
+	using tcp_socket = Session::tcp_socket;
+	using ssl_tcp_socket = Session::ssl_tcp_socket;
+	using steady_timer = Session::steady_timer;
+
+	// plaintext without an ssl context
+	static void spawn(tcp_socket && socket, asio::ssl::context * ssl_context, Tcp_server & server, std::uint64_t client_id) noexcept;
+
+private:
+	// naming the strand keeps any_io_executor out of the frames
+	constexpr static asio::use_awaitable_t<strand_type> use_awaitable{};
+
+	static asio::awaitable<void, strand_type> run(tcp_socket socket, asio::ssl::context * ssl_context, Tcp_server & server,
+								   std::uint64_t client_id);
+
+	template <typename stream_type>
+	static asio::awaitable<void, strand_type> echo(stream_type & stream, tcp_socket & socket, Tcp_server & server, std::uint64_t client_id);
+
+	static void close(tcp_socket & socket, Tcp_server & server, std::uint64_t client_id) noexcept;
+};
+
+#endif // ASIO_HAS_CO_AWAIT
+
+#endif // COROUTINE_SESSION_HXX
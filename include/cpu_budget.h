@@ -0,0 +1,31 @@
+#ifndef CPU_BUDGET_HXX
+#define CPU_BUDGET_HXX
+
+#include <sys/types.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// the cpu the process may use and what the scheduler withholds, from the affinity mask, the cgroup and procfs
+class Cpu_budget {
+public:
+	// cores in the affinity mask of the process
+	static std::size_t available_cpus() noexcept;
+	// available_cpus capped by the cgroup cpu quota, rounded up. a quota of 1.5 cpus gives 2
+	static std::size_t usable_cpus() noexcept;
+	// time the cgroup has spent throttled for running through its quota. zero without a quota
+	static std::chrono::microseconds throttled_time() noexcept;
+	// time the thread has spent runnable but waiting for a cpu
+	static std::chrono::nanoseconds run_delay(pid_t thread_id) noexcept;
+	static pid_t current_thread_id() noexcept;
+
+private:
+	// the file of the cpu controller for the cgroup of the process. empty if there is neither a v2 nor a v1 copy
+	static std::string controller_file(const char * v2_name, const char * v1_name) noexcept;
+	// the value following key in a "key value" per line file such as cpu.stat
+	static std::optional<std::uint64_t> stat_value(const std::string & path, const std::string & key) noexcept;
+};
+
+#endif // CPU_BUDGET_HXX
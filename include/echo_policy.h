@@ -0,0 +1,40 @@
+#ifndef ECHO_POLICY_HXX
+#define ECHO_POLICY_HXX
+
+#include "server_options.h"
+#include "buffer_pool.h"
+
+#include <asio/error_code.hpp>
+#include <cstddef>
+
+// read buffer sizing, output watermarks and corking, shared by both connection lifecycles. one per connection
+class Echo_policy {
+public:
+	explicit Echo_policy(const Server_options & options) noexcept;
+
+	// whether a read that failed with this error still carries the last of the client's input
+	static bool input_finished(const asio::error_code & error_code) noexcept;
+
+	// starts small. a client that fills it gets a larger one before the next read
+	Buffer_pool::Buffer initial_read_buffer() noexcept;
+	void record_read(std::size_t bytes_read, std::size_t buffer_capacity) noexcept;
+	// swaps the read buffer for one of another size once the reads seen so far call for it. true if it did
+	bool adapt_read_buffer(Buffer_pool::Buffer & read_buffer) noexcept;
+
+	bool output_full(std::size_t queued_output) const noexcept;
+	bool output_drained(std::size_t queued_output) const noexcept;
+
+	// corks ahead of a write the policy finds worth it. the socket stays corked through the rest of the burst
+	void begin_write(int socket_fd, std::size_t write_size) noexcept;
+	void end_burst(int socket_fd) noexcept;
+
+private:
+	constexpr static std::size_t read_average_weight = 8; // roughly the last eight reads shape the average
+
+	const Server_options & m_options;
+	std::size_t m_read_size_sum = 0; // read_average_weight times the moving average
+	bool m_read_filled = false;
+	bool m_corked = false;
+};
+
+#endif // ECHO_POLICY_HXX
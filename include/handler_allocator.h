@@ -0,0 +1,178 @@
+#ifndef HANDLER_ALLOCATOR_HXX
+#define HANDLER_ALLOCATOR_HXX
+
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <atomic>
+#include <array>
+#include <new>
+
+// fixed arena for the asynchronous operations of one session. a session has at most a read, a write and a posted
+// continuation in flight so a handful of slots covers its steady state and the global operator new is never reached.
+// the exception is an io_context run by several workers. a strand that finds more handlers queued on its way out
+// reschedules itself through asio's own one block per thread cache, which misses once the session hops threads. that
+// costs about three calls per hundred echoes
+class Handler_memory {
+public:
+	Handler_memory() = default;
+	Handler_memory(const Handler_memory & rhs) = delete;
+	Handler_memory & operator=(const Handler_memory & rhs) = delete;
+
+	void * allocate(std::size_t size);
+	void deallocate(void * pointer) noexcept;
+
+	// handlers run through any arena so far
+	static std::uint64_t invocations() noexcept;
+
+private:
+	template <typename>
+	friend class Custom_alloc_handler;
+
+	constexpr static std::size_t slot_size = 512;
+	constexpr static std::size_t slot_count = 4;
+
+	struct Slot {
+		alignas(std::max_align_t) std::byte storage[slot_size];
+	};
+
+	std::array<Slot, slot_count> m_slots;
+	// operations are allocated on the session strand but freed on whichever thread completes them
+	std::array<std::atomic_bool, slot_count> m_slot_in_use{};
+	inline static std::atomic_uint64_t m_invocations = 0;
+};
+
+template <typename T>
+class Handler_allocator {
+public:
+	using value_type = T;
+
+	explicit Handler_allocator(Handler_memory & memory) noexcept;
+
+	template <typename U>
+	Handler_allocator(const Handler_allocator<U> & rhs) noexcept;
+
+	T * allocate(std::size_t count) const;
+	void deallocate(T * pointer, std::size_t count) const noexcept;
+
+	template <typename U>
+	bool operator==(const Handler_allocator<U> & rhs) const noexcept;
+
+	template <typename U>
+	bool operator!=(const Handler_allocator<U> & rhs) const noexcept;
+
+private:
+	template <typename>
+	friend class Handler_allocator;
+
+	Handler_memory & m_memory;
+};
+
+// exposes the arena to asio through associated_allocator. every operation and every composed sub-operation started
+// with the wrapped handler is then allocated from the arena
+template <typename handler_type>
+class Custom_alloc_handler {
+public:
+	using allocator_type = Handler_allocator<handler_type>;
+
+	Custom_alloc_handler(Handler_memory & memory, handler_type handler);
+
+	allocator_type get_allocator() const noexcept;
+
+	template <typename... args_type>
+	void operator()(args_type &&... args);
+
+private:
+	Handler_memory & m_memory;
+	handler_type m_handler;
+};
+
+template <typename handler_type>
+Custom_alloc_handler<std::decay_t<handler_type>> make_custom_alloc_handler(Handler_memory & memory, handler_type && handler);
+
+inline void * Handler_memory::allocate(const std::size_t size) {
+
+	if(size <= slot_size) {
+		for(std::size_t i = 0; i < slot_count; i++) {
+			bool expected = false;
+
+			if(m_slot_in_use[i].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+				return m_slots[i].storage;
+			}
+		}
+	}
+
+	return ::operator new(size);
+}
+
+inline void Handler_memory::deallocate(void * const pointer) noexcept {
+
+	for(std::size_t i = 0; i < slot_count; i++) {
+		if(pointer == m_slots[i].storage) {
+			m_slot_in_use[i].store(false, std::memory_order_release);
+			return;
+		}
+	}
+
+	::operator delete(pointer);
+}
+
+inline std::uint64_t Handler_memory::invocations() noexcept {
+	return m_invocations.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+Handler_allocator<T>::Handler_allocator(Handler_memory & memory) noexcept : m_memory(memory) {
+}
+
+template <typename T>
+template <typename U>
+Handler_allocator<T>::Handler_allocator(const Handler_allocator<U> & rhs) noexcept : m_memory(rhs.m_memory) {
+}
+
+template <typename T>
+T * Handler_allocator<T>::allocate(const std::size_t count) const {
+	return static_cast<T *>(m_memory.allocate(sizeof(T) * count));
+}
+
+template <typename T>
+void Handler_allocator<T>::deallocate(T * const pointer, std::size_t /* count */) const noexcept {
+	m_memory.deallocate(pointer);
+}
+
+template <typename T>
+template <typename U>
+bool Handler_allocator<T>::operator==(const Handler_allocator<U> & rhs) const noexcept {
+	return &m_memory == &rhs.m_memory;
+}
+
+template <typename T>
+template <typename U>
+bool Handler_allocator<T>::operator!=(const Handler_allocator<U> & rhs) const noexcept {
+	return &m_memory != &rhs.m_memory;
+}
+
+template <typename handler_type>
+Custom_alloc_handler<handler_type>::Custom_alloc_handler(Handler_memory & memory, handler_type handler)
+    : m_memory(memory), m_handler(std::move(handler)) {
+}
+
+template <typename handler_type>
+typename Custom_alloc_handler<handler_type>::allocator_type Custom_alloc_handler<handler_type>::get_allocator() const noexcept {
+	return allocator_type(m_memory);
+}
+
+template <typename handler_type>
+template <typename... args_type>
+void Custom_alloc_handler<handler_type>::operator()(args_type &&... args) {
+	Handler_memory::m_invocations.fetch_add(1, std::memory_order_relaxed);
+	m_handler(std::forward<args_type>(args)...);
+}
+
+template <typename handler_type>
+Custom_alloc_handler<std::decay_t<handler_type>> make_custom_alloc_handler(Handler_memory & memory, handler_type && handler) {
+	return Custom_alloc_handler<std::decay_t<handler_type>>(memory, std::forward<handler_type>(handler));
+}
+
+#endif // HANDLER_ALLOCATOR_HXX
\ No newline at end of file
@@ -0,0 +1,65 @@
+#ifndef LISTENER_HXX
+#define LISTENER_HXX
+
+#include "tcp_server.h"
+
+#include <chrono>
+#include <cstddef>
+
+// accepts a shard's connections on one backend and hands every one of them to Tcp_server::create_session
+class Tcp_server::Listener {
+public:
+	Listener(Tcp_server & server, Shard & shard) noexcept;
+	Listener(const Listener & rhs) = delete;
+	Listener(Listener && rhs) = delete;
+	Listener & operator=(const Listener & rhs) = delete;
+	Listener & operator=(Listener && rhs) = delete;
+	virtual ~Listener() = default;
+
+	// the shard's acceptor is open and bound by then
+	virtual void listen() noexcept = 0;
+
+protected:
+	// errno values of a full descriptor table or memory pressure. accepting again right away would fail the same way
+	static bool out_of_resources(int error) noexcept;
+	// arms the accept again from the accept strand once accept_backoff has passed, unless the server stops meanwhile
+	void back_off() noexcept;
+	///
+	constexpr static auto accept_backoff = std::chrono::milliseconds(100);
+
+	Tcp_server & m_server;
+	Shard & m_shard;
+
+private:
+	virtual void rearm() noexcept = 0;
+};
+
+// asio's reactor. several accepts stay in flight and each completion drains whatever queued up behind it
+class Tcp_server::Reactor_listener final : public Tcp_server::Listener {
+public:
+	using Listener::Listener;
+
+	void listen() noexcept override;
+
+private:
+	void accept() noexcept;
+	void drain_accept_queue() noexcept;
+	void rearm() noexcept override;
+	///
+	// connections taken synchronously after each accept completion before the accept is armed again
+	constexpr static std::size_t accept_batch_size = 64;
+};
+
+// accepts through the shard's io_uring. the descriptors it hands over stay out of the reactor
+class Tcp_server::Uring_listener final : public Tcp_server::Listener, Uring_backend::Operation {
+public:
+	using Listener::Listener;
+
+	void listen() noexcept override;
+
+private:
+	void complete(int result, bool more) noexcept override;
+	void rearm() noexcept override;
+};
+
+#endif // LISTENER_HXX
@@ -0,0 +1,105 @@
+#ifndef SERVER_OPTIONS_HXX
+#define SERVER_OPTIONS_HXX
+
+#include "buffer_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <functional>
+
+enum class Echo_mode {
+	buffered, // accumulate until the client half-closes, then echo everything at once
+	streaming // echo every chunk as soon as it is read
+};
+
+enum class Transport {
+	tls,
+	plaintext // streaming echo goes through splice(2) and never reaches user space
+};
+
+enum class Io_backend {
+	epoll, // asio's own reactor
+	io_uring // plaintext sessions only. asio::ssl issues its own socket operations, so tls stays on the reactor
+};
+
+// how the listener's sockets trade segment count for latency
+enum class Flush_policy {
+	latency, // TCP_NODELAY. every write leaves at once
+	throughput, // nagle stays on and every write burst is corked until it is over
+	adaptive // TCP_NODELAY. only bursts that take several writes are corked
+};
+
+enum class Threading {
+	shared, // every worker thread runs the one io_context
+	sharded // every worker thread runs an io_context and an SO_REUSEPORT acceptor of its own
+};
+
+// what a worker thread does while its io_context has nothing ready to run
+enum class Idle_strategy {
+	block, // sleeps in epoll_wait. no cpu at idle, a wakeup's worth of latency on the next event
+	spin_then_block, // polls for idle_spin before it goes to sleep. absorbs the gaps inside a burst
+	busy_poll // never sleeps. lowest latency, and a full core per worker thread whether there is traffic or not
+};
+
+enum class Lifecycle {
+	callbacks, // a chain of completion handlers per connection
+	// one coroutine per connection with TCPSERVER_COROUTINES. falls back to callbacks for options it does not cover
+	coroutine
+};
+
+// may rewrite the message in place before it is echoed. must be safe to call concurrently for different messages
+using Message_stage = std::function<void(Buffer_pool::Buffer & message)>;
+
+struct Server_options {
+	Transport transport = Transport::tls;
+	Echo_mode echo_mode = Echo_mode::buffered;
+	Io_backend io_backend = Io_backend::epoll;
+	Threading threading = Threading::shared;
+	Lifecycle lifecycle = Lifecycle::callbacks;
+	// connections the kernel queues for the listener until they are accepted. net.core.somaxconn caps it
+	int listen_backlog = 4096;
+	// accepts kept in flight per worker thread of a shard. a single readiness wakeup completes all of them
+	std::size_t accepts_per_worker = 1;
+	// connections served at once, those still in their tls handshake included. connections beyond it are turned away
+	std::size_t max_connections = 100;
+	// a tls client that has not finished its handshake by then is dropped and frees its max_connections slot. 0 waits
+	std::chrono::milliseconds handshake_timeout{10000};
+	// new connections admitted a second, with bursts of up to accept_burst. 0 admits them as fast as they arrive
+	double accept_rate = 0;
+	double accept_burst = 64;
+	Flush_policy flush_policy = Flush_policy::adaptive;
+	Idle_strategy idle_strategy = Idle_strategy::block;
+	std::chrono::microseconds idle_spin{50};
+	// shared threading only. the thread count becomes a ceiling and the running workers follow the scheduler lag
+	bool dynamic_threads = false;
+	// SO_BUSY_POLL on the listener's sockets. 0 disables it. above net.core.busy_read it takes CAP_NET_ADMIN
+	std::chrono::microseconds socket_busy_poll{0};
+	// bounds of the read buffer every session sizes from its reads. the upper one defaults to a full TLS record
+	std::size_t min_read_buffer = 512;
+	std::size_t max_read_buffer = 16 * 1024;
+	// reads of a session pause once this many echoed bytes wait to be sent
+	std::size_t output_high_watermark = 64 * 1024;
+	// and resume once the backlog drains down to this many
+	std::size_t output_low_watermark = 16 * 1024;
+	// plaintext writes of at least this many bytes are sent with MSG_ZEROCOPY. 0 disables it. the break-even depends on
+	// the device. loopback copies anyway and never gets there, so measure with echo_cost_benchmark on the real link
+	std::size_t zerocopy_threshold = 0;
+	// hands the keys to the kernel tls module after the handshake. a direction it does not support stays in openssl
+	bool kernel_tls = false;
+	// openssl straight on the socket, without asio's stream buffers, and its record buffers released whenever they run
+	// empty. an idle connection holds about 17 KB instead of 79 KB (echo_cost_benchmark connections=<n>), but every echo
+	// mallocs and frees a read and a write record buffer
+	bool compact_tls = false;
+	// worker thread i is pinned to worker_cpus[i % size]. buffers only stay node local with sharded threading
+	std::vector<int> worker_cpus;
+	// sharded and pinned only. each shard accepts the connections whose softirq runs on its worker's core
+	bool steer_incoming_cpu = false;
+	// empty echoes every message as read. a stage also takes plaintext streaming off splice, which never sees the payload
+	Message_stage message_stage;
+	// threads running the message stage. 0 runs it inline on the session's i/o thread
+	std::size_t compute_threads = 0;
+};
+
+#endif // SERVER_OPTIONS_HXX
\ No newline at end of file
@@ -0,0 +1,97 @@
+#ifndef SESSION_HXX
+#define SESSION_HXX
+
+#include "server_options.h"
+#include "echo_policy.h"
+#include "handler_allocator.h"
+#include "buffer_pool.h"
+#include "uring_backend.h"
+#include "tcp_flush.h"
+
+#include <asio/basic_waitable_timer.hpp>
+#include <asio/ssl/context.hpp>
+#include <asio/ssl/stream.hpp>
+#include <asio/io_context.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/strand.hpp>
+#include <string_view>
+#include <chrono>
+#include <memory>
+
+class Tcp_server;
+
+class Session : public std::enable_shared_from_this<Session> {
+public:
+	using strand_type = asio::strand<asio::io_context::executor_type>;
+	// the strand is named concretely. a type-erased any_io_executor heap-allocates on every copy of a strand
+	using tcp_socket = asio::basic_stream_socket<asio::ip::tcp, strand_type>;
+	using ssl_tcp_socket = asio::ssl::stream<tcp_socket &>;
+	using steady_timer = asio::basic_waitable_timer<std::chrono::steady_clock, asio::wait_traits<std::chrono::steady_clock>, strand_type>;
+
+	// the socket is expected to be bound to its own strand. every handler of the session then runs serialized on it
+	Session(tcp_socket && socket, Tcp_server & server, std::uint64_t client_id);
+	// io_uring session. the descriptor stays out of the reactor and the unopened socket only provides the strand
+	Session(tcp_socket && socket, Uring_backend & uring, int uring_fd, Tcp_server & server, std::uint64_t client_id);
+	Session(tcp_socket && socket, asio::ssl::context & ssl_context, Tcp_server & server, std::uint64_t client_id);
+	Session(const Session & rhs) = delete;
+	Session(Session && rhs) = delete;
+	Session & operator=(const Session & rhs) = delete;
+	Session & operator=(Session && rhs) = delete;
+	~Session();
+
+	void start() noexcept;
+
+private:
+	class Io;
+	class Reactor_io;
+	class Zerocopy_io;
+	class Asio_tls_io;
+	class Socket_tls_io;
+	class Uring_io;
+
+	void start_echo() noexcept;
+	void read_message() noexcept;
+	void complete_read(const asio::error_code & error_code, std::size_t bytes_read) noexcept;
+	void handle_message(std::string_view content, const asio::error_code & connection_code) noexcept;
+	void stage_message(std::string_view content, const asio::error_code & connection_code) noexcept;
+	void complete_stage() noexcept;
+	void process_message(std::string_view content, const asio::error_code & connection_code) noexcept;
+	void stream_message(std::string_view content, const asio::error_code & connection_code) noexcept;
+	void respond(std::string_view response) noexcept;
+	void queue_response(std::string_view response) noexcept;
+	void flush_responses() noexcept;
+	void complete_write(const asio::error_code & error_code, std::size_t bytes_sent) noexcept;
+	void shutdown_socket() noexcept;
+	void close_when_sent() noexcept;
+	void continue_reading() noexcept;
+	std::size_t queued_output_size() const noexcept;
+
+	template <typename handler_type>
+	auto bind_handler_memory(handler_type && handler);
+	///
+	tcp_socket m_socket;
+	// armed from start until the echo starts. tls only
+	steady_timer m_handshake_timer;
+	Tcp_server & m_server;
+	std::unique_ptr<Io> m_io;
+	Echo_policy m_echo_policy;
+	Handler_memory m_handler_memory;
+	Buffer_pool::Buffer m_read_buffer;
+	Buffer_pool::Buffer m_pending_output;
+	Buffer_pool::Buffer m_inflight_output;
+	// the one message a compute thread hands back. no read is issued while it is away
+	Buffer_pool::Buffer m_staged_message;
+	asio::error_code m_staged_connection_code;
+	std::uint64_t m_client_id = 0;
+	bool m_write_in_progress = false;
+	bool m_read_paused = false;
+	bool m_read_finished = false;
+	bool m_closed = false;
+};
+
+template <typename handler_type>
+auto Session::bind_handler_memory(handler_type && handler) {
+	return make_custom_alloc_handler(m_handler_memory, std::forward<handler_type>(handler));
+}
+
+#endif // SESSION_HXX
\ No newline at end of file
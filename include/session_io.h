@@ -0,0 +1,153 @@
+#ifndef SESSION_IO_HXX
+#define SESSION_IO_HXX
+
+#include "session.h"
+
+#include <openssl/ssl.h>
+#include <memory>
+#include <vector>
+
+// a session's reads and writes on one transport and backend. every completion runs serialized with the session
+class Session::Io {
+public:
+	explicit Io(Session & session) noexcept;
+	Io(const Io & rhs) = delete;
+	Io(Io && rhs) = delete;
+	Io & operator=(const Io & rhs) = delete;
+	Io & operator=(Io && rhs) = delete;
+	virtual ~Io() = default;
+
+	// starts the echo once the transport is ready for it
+	virtual void handshake() noexcept;
+	virtual void read() noexcept = 0;
+	virtual void write() noexcept = 0;
+	virtual void close() noexcept = 0;
+	virtual int native_handle() const noexcept = 0;
+	// runs Session::complete_stage wherever this backend's completions run
+	virtual void complete_stage() noexcept;
+	virtual void read_buffer_replaced() noexcept;
+	// a written buffer the kernel may still read from is held back instead of being cleared for reuse
+	virtual void release_output(Buffer_pool::Buffer & output) noexcept;
+	// true if the backend closes the session itself once the kernel lets go of every buffer
+	virtual bool defer_close() noexcept;
+
+protected:
+	Session & m_session;
+};
+
+// asio's reactor on a plaintext socket
+class Session::Reactor_io : public Session::Io {
+public:
+	using Io::Io;
+
+	void read() noexcept override;
+	void write() noexcept override;
+	void close() noexcept override;
+	int native_handle() const noexcept override;
+};
+
+class Session::Zerocopy_io final : public Session::Reactor_io {
+public:
+	using Reactor_io::Reactor_io;
+
+	void handshake() noexcept override;
+	void write() noexcept override;
+	void release_output(Buffer_pool::Buffer & output) noexcept override;
+	bool defer_close() noexcept override;
+
+private:
+	struct Held_buffer {
+		Buffer_pool::Buffer buffer;
+		// released once the kernel reports every send number below this
+		std::uint32_t sends_upto;
+	};
+
+	void send(std::size_t offset) noexcept;
+	void reap_completions() noexcept;
+	///
+	std::vector<Held_buffer> m_held_buffers;
+	std::uint32_t m_sends = 0;
+	std::uint32_t m_held_upto = 0;
+	std::uint32_t m_completed = 0;
+	bool m_enabled = false;
+	bool m_wait_armed = false;
+	bool m_close_pending = false;
+};
+
+class Session::Asio_tls_io final : public Session::Reactor_io {
+public:
+	Asio_tls_io(Session & session, asio::ssl::context & ssl_context) noexcept;
+
+	void handshake() noexcept override;
+	void read() noexcept override;
+	void write() noexcept override;
+
+private:
+	ssl_tcp_socket m_ssl_socket;
+};
+
+// openssl bound straight to the socket
+class Session::Socket_tls_io final : public Session::Reactor_io {
+public:
+	Socket_tls_io(Session & session, asio::ssl::context & ssl_context) noexcept;
+
+	void handshake() noexcept override;
+	void read() noexcept override;
+	void write() noexcept override;
+
+private:
+	struct Ssl_deleter {
+		void operator()(SSL * ssl) const noexcept { SSL_free(ssl); }
+	};
+
+	void receive() noexcept;
+	void send(std::size_t offset) noexcept;
+	asio::error_code error(int ssl_error) const noexcept;
+
+	// waits for the readiness openssl asked for and runs the continuation on the strand. false if the error is not a retry
+	template <typename continuation_type>
+	bool wait(int ssl_error, continuation_type continuation);
+	///
+	std::unique_ptr<SSL, Ssl_deleter> m_ssl;
+	std::size_t m_parked_read_capacity = 0; // the read buffer's size while the session waits without one
+	bool m_started = false;
+};
+
+class Session::Uring_io final : public Session::Io {
+public:
+	Uring_io(Session & session, Uring_backend & uring, int fd) noexcept;
+
+	void read() noexcept override;
+	void write() noexcept override;
+	void close() noexcept override;
+	int native_handle() const noexcept override;
+	void complete_stage() noexcept override;
+	void read_buffer_replaced() noexcept override;
+
+private:
+	struct Request final : Uring_backend::Operation {
+		Request(Uring_io & io, void (Uring_io::*on_complete)(int result) noexcept) noexcept;
+		void complete(int result, bool more) noexcept override;
+
+		Uring_io & io;
+		void (Uring_io::*on_complete)(int result) noexcept;
+		// the kernel owns the request until it completes, so the session has to outlive it
+		std::shared_ptr<Session> session;
+	};
+
+	void send() noexcept;
+	void complete_read(int result) noexcept;
+	void complete_write(int result) noexcept;
+	void return_stage(int result) noexcept;
+	static asio::error_code error(int result) noexcept;
+	///
+	Uring_backend & m_uring;
+	Request m_read{*this, &Uring_io::complete_read};
+	Request m_write{*this, &Uring_io::complete_write};
+	Request m_stage{*this, &Uring_io::return_stage};
+	std::size_t m_sent = 0;
+	int m_fd = -1;
+	int m_buffer_index = -1;
+};
+
+#endif // SESSION_IO_HXX
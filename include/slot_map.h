@@ -0,0 +1,59 @@
+#ifndef SLOT_MAP_HXX
+#define SLOT_MAP_HXX
+
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// lock-free ids of a slot index and its generation. releasing a slot bumps the generation, so a stale id never matches
+class Slot_map {
+public:
+	// for threads without a free list of their own
+	constexpr static std::size_t shared_free_list = static_cast<std::size_t>(-1);
+
+	// capacity ids can be taken at once however many free slots sit on other threads' free lists
+	Slot_map(std::size_t capacity, std::size_t local_free_lists);
+	Slot_map(const Slot_map & rhs) = delete;
+	Slot_map(Slot_map && rhs) = delete;
+	Slot_map & operator=(const Slot_map & rhs) = delete;
+	Slot_map & operator=(Slot_map && rhs) = delete;
+	~Slot_map() = default;
+
+	// free_list is the calling thread's own, or shared_free_list. empty once every slot is taken
+	std::optional<std::uint64_t> acquire(std::size_t free_list) noexcept;
+	void release(std::uint64_t id, std::size_t free_list) noexcept;
+	bool contains(std::uint64_t id) const noexcept;
+
+private:
+	static std::uint32_t index_of(std::uint64_t id) noexcept;
+	static std::uint32_t generation_of(std::uint64_t id) noexcept;
+	std::optional<std::uint32_t> pop_shared() noexcept;
+	void push_shared(std::uint32_t index) noexcept;
+	///
+	// beyond this a local free list spills into the shared stack, so slots do not pile up on a thread that only releases
+	constexpr static std::size_t local_free_list_limit = 64;
+	constexpr static std::uint32_t no_index = static_cast<std::uint32_t>(-1);
+
+	std::size_t m_capacity = 0;
+	// odd while the slot is taken
+	std::unique_ptr<std::atomic_uint32_t[]> m_generations;
+	std::unique_ptr<std::atomic_uint32_t[]> m_next_shared;
+	// index of the top slot in the low half, a tag bumped on every pop in the high half against aba
+	std::atomic_uint64_t m_shared_head;
+	// slots never handed out so far. they need no free list until their first release
+	std::atomic_size_t m_untouched = 0;
+	std::vector<std::vector<std::uint32_t>> m_local_free_lists;
+};
+
+inline std::uint32_t Slot_map::index_of(const std::uint64_t id) noexcept {
+	return static_cast<std::uint32_t>(id);
+}
+
+inline std::uint32_t Slot_map::generation_of(const std::uint64_t id) noexcept {
+	return static_cast<std::uint32_t>(id >> 32);
+}
+
+#endif // SLOT_MAP_HXX
@@ -0,0 +1,52 @@
+#ifndef SPLICE_SESSION_HXX
+#define SPLICE_SESSION_HXX
+
+#include "handler_allocator.h"
+#include "session.h"
+#include "tcp_flush.h"
+
+#include <memory>
+#include <array>
+
+class Tcp_server;
+
+// plaintext echo that never copies the payload into user space. bytes move from the socket into a pipe and from the
+// pipe back into the socket with splice(2), so this session is linux only
+class Splice_session : public std::enable_shared_from_this<Splice_session> {
+public:
+	using tcp_socket = Session::tcp_socket;
+
+	Splice_session(tcp_socket && socket, Tcp_server & server, std::uint64_t client_id);
+	Splice_session(const Splice_session & rhs) = delete;
+	Splice_session(Splice_session && rhs) = delete;
+	Splice_session & operator=(const Splice_session & rhs) = delete;
+	Splice_session & operator=(Splice_session && rhs) = delete;
+	~Splice_session();
+
+	void start() noexcept;
+
+private:
+	bool open_pipe() noexcept;
+	void pump() noexcept;
+	void shutdown_socket() noexcept;
+
+	template <typename handler_type>
+	auto bind_handler_memory(handler_type && handler);
+	///
+	tcp_socket m_socket;
+	Tcp_server & m_server;
+	Handler_memory m_handler_memory;
+	std::array<int, 2> m_pipe{-1, -1};
+	std::size_t m_pipe_capacity = 0;
+	std::size_t m_pipe_bytes = 0;
+	std::uint64_t m_client_id = 0;
+	bool m_read_finished = false;
+	bool m_closed = false;
+};
+
+template <typename handler_type>
+auto Splice_session::bind_handler_memory(handler_type && handler) {
+	return make_custom_alloc_handler(m_handler_memory, std::forward<handler_type>(handler));
+}
+
+#endif // SPLICE_SESSION_HXX
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef TCP_FLUSH_HXX
+#define TCP_FLUSH_HXX
+
+#include "server_options.h"
+
+#include <cstdint>
+#include <cstddef>
+
+// the listener's flush policy on an accepted socket. a corked socket holds partial segments back until its burst is over
+class Tcp_flush {
+public:
+	struct Segment_counts {
+		std::uint64_t segments = 0; // everything sent, pure acks included
+		std::uint64_t data_segments = 0;
+		std::uint64_t bytes = 0;
+	};
+
+	static void configure(int socket_fd, Flush_policy policy) noexcept;
+	// whether a burst of this many bytes is worth the two extra setsockopt calls of corking it
+	static bool should_cork(Flush_policy policy, std::size_t burst_size) noexcept;
+	// the same for a turn that has already issued this many writes without knowing how many more will follow
+	static bool should_cork_turn(Flush_policy policy, std::size_t writes_so_far) noexcept;
+	static void cork(int socket_fd, bool corked) noexcept;
+	// straight from tcp_info, so these are what actually went out rather than what was written
+	static Segment_counts segment_counts(int socket_fd) noexcept;
+
+private:
+	// beyond one tls record a burst takes several writes to go out
+	constexpr static std::size_t adaptive_cork_threshold = 16 * 1024;
+};
+
+#endif // TCP_FLUSH_HXX
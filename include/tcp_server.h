@@ -2,6 +2,15 @@
 #define TCP_SERVER_HXX
 
 #include "server_logger.h"
+#include "server_options.h"
+#include "splice_session.h"
+#include "coroutine_session.h"
+#include "session.h"
+#include "uring_backend.h"
+#include "thread_placement.h"
+#include "cpu_budget.h"
+#include "slot_map.h"
+#include "token_bucket.h"
 
 #include <asio/executor_work_guard.hpp>
 #include <asio/thread_pool.hpp>
@@ -9,25 +18,24 @@
 #include <asio/ssl/stream.hpp>
 #include <asio/io_context.hpp>
 #include <asio/ip/tcp.hpp>
-#include <shared_mutex>
+#include <asio/strand.hpp>
+#include <condition_variable>
 #include <thread>
+#include <optional>
 #include <atomic>
-#include <random>
-#include <set>
-#include <map>
+#include <memory>
+#include <vector>
 
 class Tcp_server {
 public:
-	using tcp_socket = asio::ip::tcp::socket;
-	using ssl_tcp_socket = asio::ssl::stream<tcp_socket>;
+	using tcp_socket = Session::tcp_socket;
+	using ssl_tcp_socket = Session::ssl_tcp_socket;
+	using Echo_mode = ::Echo_mode;
 
-	struct Network_message {
-		std::shared_ptr<ssl_tcp_socket> ssl_socket;
-		std::shared_ptr<std::string> content;
-		std::uint64_t client_id;
-	};
+	// sizes the worker set from the cpus the process may use, the cgroup cpu quota included
+	constexpr static std::size_t automatic_thread_count = 0;
 
-	Tcp_server(std::uint8_t thread_count, std::uint16_t listen_port, std::string_view auth_dir);
+	Tcp_server(std::size_t thread_count, std::uint16_t listen_port, std::string_view auth_dir, Server_options options = {});
 	Tcp_server(const Tcp_server & rhs) = delete;
 	Tcp_server(Tcp_server && rhs) = delete;
 	Tcp_server & operator=(const Tcp_server & rhs) = delete;
@@ -38,44 +46,120 @@ public:
 	void shutdown() noexcept;
 
 private:
-	std::uint64_t get_random_spare_id() const noexcept;
-	void listen() noexcept;
-	void connection_timeout() noexcept;
+	friend class Session;
+	friend class Splice_session;
+	friend class Coroutine_session;
+
+	class Listener;
+	class Reactor_listener;
+	class Uring_listener;
+
+	// an io_context with its acceptor. shared threading runs one shard on every worker, sharded threading one per worker
+	struct Shard {
+		Shard(int concurrency_hint, int cpu, Token_bucket accept_bucket);
+		~Shard();
+
+		asio::io_context io_context;
+		// every acceptor operation runs on it. the accepts in flight share the acceptor with the draining loop
+		asio::strand<asio::io_context::executor_type> accept_strand{io_context.get_executor()};
+		asio::executor_work_guard<asio::io_context::executor_type> executor_guard = asio::make_work_guard(io_context);
+		asio::ip::tcp::acceptor acceptor{io_context};
+		std::unique_ptr<Uring_backend> uring; // empty while the epoll backend is in use
+		std::unique_ptr<Listener> listener;
+		int cpu; // the core of the only worker running the shard. -1 if unpinned or shared by several workers
+		// the shard's part of the accept rate. only ever taken from by the accept strand or the ring thread
+		Token_bucket accept_bucket;
+	};
+
+	// uring_fd is the accepted descriptor of a session whose socket i/o goes through the shard's io_uring
+	void create_session(Shard & shard, tcp_socket && socket, int uring_fd = -1) noexcept;
+	// empty if admitted. the admitted connection holds a max_connections slot until on_session_closed
+	std::string_view admission_refusal(Shard & shard) noexcept;
+	void turn_away(int socket_fd, std::string_view reason) noexcept;
+	void open_uring(Shard & shard) noexcept;
 	void configure_ssl_context() noexcept;
-	void configure_acceptor() noexcept;
-	void shutdown_socket(std::shared_ptr<ssl_tcp_socket> socket, std::uint64_t client_id) noexcept;
-	void attempt_handshake(std::shared_ptr<ssl_tcp_socket> ssl_socket, std::uint64_t client_id) noexcept;
-	void read_message(std::shared_ptr<ssl_tcp_socket> ssl_socket, std::uint64_t client_id) noexcept;
-	void respond(std::shared_ptr<ssl_tcp_socket> ssl_socket, std::string response, std::uint64_t client_id) noexcept;
-	void process_message(const Network_message & message, const asio::error_code & connection_code) noexcept;
+	void configure_acceptor(Shard & shard) noexcept;
+	void place_worker(int cpu) noexcept;
+	void run_worker(asio::io_context & io_context) noexcept;
+	void park_surplus_worker() noexcept;
+	void monitor_workers(Shard & shard) noexcept;
+	void adjust_workers(Shard & shard, std::chrono::steady_clock::duration queue_lag) noexcept;
+	void on_session_closed(std::uint64_t client_id) noexcept;
+	void on_segments_sent(const Tcp_flush::Segment_counts & sent) noexcept;
 	///
-	constexpr static auto minimum_thread_count = 1;
-	constexpr static auto max_connections = 100;
-	constexpr static auto timeout_seconds = 5;
-	inline static std::mt19937 random_generator{std::random_device()()};
-	inline static std::uniform_int_distribution<std::uint64_t> random_id_range;
+	constexpr static std::size_t minimum_thread_count = 1;
+	constexpr static auto worker_adjust_interval = std::chrono::milliseconds(1000);
+	// a probe handler waiting this long in the queue means the running workers cannot keep up
+	constexpr static auto worker_grow_lag = std::chrono::microseconds(500);
+	// running workers waiting on the cpu or the cgroup quota for this share of the interval means there are too many
+	constexpr static auto worker_oversubscribed_divisor = 10;
+	// adjustments a shrink holds growth back for. the freed cpu would otherwise invite the very same worker straight back
+	constexpr static auto worker_grow_holdoff = 10;
+	// the calling thread's client id free list. threads outside the pool share one
+	inline static thread_local std::size_t worker_index = Slot_map::shared_free_list;
 
-	asio::io_context m_io_context;
 	asio::ssl::context m_ssl_context{asio::ssl::context::tlsv12_server};
-	asio::executor_work_guard<asio::io_context::executor_type> m_executor_guard = asio::make_work_guard(m_io_context);
-	asio::ip::tcp::acceptor m_acceptor{m_io_context};
-	std::set<std::uint64_t> m_active_client_ids;
-	std::map<std::uint64_t, std::string> m_received_messages;
 	std::atomic_bool m_server_running = false;
-	std::atomic_uint32_t m_active_connections = 0;
+	std::atomic_size_t m_admitted_connections = 0;
+	std::atomic_uint64_t m_segments_sent = 0;
+	std::atomic_uint64_t m_data_segments_sent = 0;
+	std::atomic_uint64_t m_bytes_sent = 0;
 	Server_logger m_logger;
-	mutable std::shared_mutex m_client_id_mutex;
-	mutable std::shared_mutex m_received_messages_mutex;
 
 	std::uint16_t m_listen_port = 0;
 	std::string_view m_auth_dir;
-	std::uint8_t m_thread_count = 0;
+	std::size_t m_thread_count = 0;
+	std::mutex m_worker_mutex;
+	std::condition_variable m_worker_wakeup;
+	std::vector<pid_t> m_worker_thread_ids;
+	std::atomic_size_t m_running_workers = 0;
+	std::atomic_size_t m_target_workers = 0;
+	std::chrono::nanoseconds m_worker_run_delay{0}; // as of the last adjustment, like the throttled time
+	std::chrono::microseconds m_throttled_time{0};
+	int m_worker_grow_holdoff = 0;
+	Server_options m_options;
+	// only admitted connections take an id, so the admission limit bounds the ids in use
+	Slot_map m_client_ids{m_options.max_connections, m_thread_count};
+	std::vector<std::unique_ptr<Shard>> m_shards;
 	asio::thread_pool m_thread_pool;
+	std::optional<asio::thread_pool> m_compute_pool; // empty while message stages run inline
 };
 
-inline Tcp_server::Tcp_server(const std::uint8_t thread_count, const std::uint16_t listen_port, const std::string_view auth_dir)
-    : m_listen_port(listen_port), m_auth_dir(auth_dir), m_thread_count(std::max<std::uint8_t>(thread_count, minimum_thread_count)),
-	m_thread_pool(m_thread_count) {
+inline Tcp_server::Tcp_server(const std::size_t thread_count, const std::uint16_t listen_port, const std::string_view auth_dir,
+				     const Server_options options)
+    : m_listen_port(listen_port), m_auth_dir(auth_dir),
+	// a dynamic worker set may grow past the quota while the quota is not being hit
+	m_thread_count(std::max(thread_count != automatic_thread_count ? thread_count
+				: options.dynamic_threads && options.threading == Threading::shared ? Cpu_budget::available_cpus()
+												     : Cpu_budget::usable_cpus(),
+				minimum_thread_count)),
+	m_target_workers(std::min(m_thread_count, Cpu_budget::usable_cpus())), m_options(options), m_thread_pool(m_thread_count) {
+	m_options.output_low_watermark = std::min(m_options.output_low_watermark, m_options.output_high_watermark);
+	m_options.max_read_buffer = std::max<std::size_t>(m_options.max_read_buffer, 1);
+	m_options.min_read_buffer = std::clamp<std::size_t>(m_options.min_read_buffer, 1, m_options.max_read_buffer);
+
+	// a shard run by a single thread lets asio skip waking other threads for every handler it queues
+	const auto sharded = m_options.threading == Threading::sharded;
+
+	// a shard cannot be left without its thread, so only the shared io_context can run on a changing number of workers
+	m_options.dynamic_threads = m_options.dynamic_threads && !sharded;
+
+	if(!m_options.dynamic_threads) {
+		m_target_workers = m_thread_count;
+	}
+
+	const auto shard_count = sharded ? m_thread_count : 1;
+
+	for(std::size_t i = 0; i < shard_count; i++) {
+		const auto cpu = sharded && !m_options.worker_cpus.empty() ? m_options.worker_cpus[i % m_options.worker_cpus.size()] : -1;
+		// the shards split the rate between them, so the listener as a whole admits the configured one
+		const Token_bucket accept_bucket(m_options.accept_rate / shard_count, m_options.accept_burst / shard_count);
+		m_shards.push_back(std::make_unique<Shard>(sharded ? 1 : m_thread_count, cpu, accept_bucket));
+	}
+
+	if(m_options.message_stage && m_options.compute_threads) {
+		m_compute_pool.emplace(m_options.compute_threads);
+	}
 }
 
 inline Tcp_server::~Tcp_server() {
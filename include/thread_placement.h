@@ -0,0 +1,15 @@
+#ifndef THREAD_PLACEMENT_HXX
+#define THREAD_PLACEMENT_HXX
+
+// cpu pinning and numa local allocation through raw syscalls, without libnuma
+class Thread_placement {
+public:
+	// false if the core does not exist or lies outside the cpuset of the process
+	static bool pin_current_thread(int cpu) noexcept;
+	// pages the calling thread faults in from now on come from its node while that node has memory free
+	static bool prefer_local_memory() noexcept;
+	// -1 if the kernel cannot tell
+	static int current_node() noexcept;
+};
+
+#endif // THREAD_PLACEMENT_HXX
@@ -0,0 +1,23 @@
+#ifndef TOKEN_BUCKET_HXX
+#define TOKEN_BUCKET_HXX
+
+#include <chrono>
+
+// a steady rate with bursts, refilled lazily on every take. not thread safe
+class Token_bucket {
+public:
+	// a rate of 0 admits everything
+	Token_bucket(double rate, double burst) noexcept;
+
+	bool try_take() noexcept;
+
+private:
+	using clock_type = std::chrono::steady_clock;
+
+	double m_rate = 0; // tokens a second
+	double m_burst = 0;
+	double m_tokens = 0;
+	clock_type::time_point m_refilled_at = clock_type::now();
+};
+
+#endif // TOKEN_BUCKET_HXX
@@ -0,0 +1,83 @@
+#ifndef URING_BACKEND_HXX
+#define URING_BACKEND_HXX
+
+#include <linux/io_uring.h>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <vector>
+
+// socket i/o through one io_uring driven with raw syscalls. the ring thread runs every completion and submits what
+// they queue with its next wait
+class Uring_backend {
+public:
+	// what a submitted request completes into. owned by the submitter and has to stay alive until its final completion
+	class Operation {
+	public:
+		// result is the cqe's res, a negated errno on failure. more is set while a multishot request stays armed
+		virtual void complete(int result, bool more) noexcept = 0;
+
+	protected:
+		~Operation() = default;
+	};
+
+	Uring_backend() = default;
+	Uring_backend(const Uring_backend & rhs) = delete;
+	Uring_backend(Uring_backend && rhs) = delete;
+	Uring_backend & operator=(const Uring_backend & rhs) = delete;
+	Uring_backend & operator=(Uring_backend && rhs) = delete;
+	~Uring_backend();
+
+	// false if the kernel refuses io_uring. nothing else may be called then
+	bool open() noexcept;
+	void start() noexcept;
+	// stops the ring thread, cancels everything in flight and runs the remaining completions on the calling thread
+	void shutdown() noexcept;
+
+	void accept(int listen_fd, Operation & operation) noexcept;
+	// buffer_index comes from register_buffer. -1 receives into an unregistered buffer
+	void receive(int socket_fd, void * data, std::size_t size, int buffer_index, Operation & operation) noexcept;
+	void send(int socket_fd, const void * data, std::size_t size, Operation & operation) noexcept;
+	// completes the operation on the ring thread with a result of 0
+	void post(Operation & operation) noexcept;
+
+	// -1 once every slot of the table is taken or the kernel has no sparse buffer tables
+	int register_buffer(void * data, std::size_t size) noexcept;
+	void unregister_buffer(int buffer_index) noexcept;
+
+	bool multishot_accept() const noexcept;
+	void disable_multishot_accept() noexcept;
+
+private:
+	// the submission mutex has to be held
+	void queue(const io_uring_sqe & sqe) noexcept;
+	void submit(const io_uring_sqe & sqe) noexcept;
+	int enter(unsigned to_submit, unsigned min_complete, unsigned flags) noexcept;
+	unsigned unsubmitted() const noexcept;
+	bool completions_ready() const noexcept;
+	void reap() noexcept;
+	void run() noexcept;
+	///
+	constexpr static unsigned ring_entries = 1024;
+	constexpr static unsigned registered_buffer_slots = 1024;
+	constexpr static int shutdown_wait_milliseconds = 1000;
+
+	std::thread m_ring_thread;
+	std::atomic_bool m_stopping = false;
+	std::mutex m_submission_mutex;
+	std::mutex m_buffer_mutex;
+	std::vector<int> m_free_buffer_slots;
+	std::atomic_uint64_t m_in_flight = 0;
+	io_uring_params m_params{};
+	int m_ring_fd = -1;
+	void * m_sq_ring = nullptr;
+	void * m_cq_ring = nullptr;
+	io_uring_sqe * m_sqes = nullptr;
+	std::size_t m_sq_ring_size = 0;
+	std::size_t m_cq_ring_size = 0;
+	bool m_multishot_accept = true;
+};
+
+#endif // URING_BACKEND_HXX
@@ -0,0 +1,105 @@
+#include "buffer_pool.h"
+
+#include <algorithm>
+#include <cstring>
+
+Buffer_pool::Free_lists::Free_lists() {
+	for(auto & free_list : lists) {
+		free_list.reserve(max_cached_per_class);
+	}
+}
+
+Buffer_pool::Free_lists::~Free_lists() {
+	for(auto & free_list : lists) {
+		for(auto * storage : free_list) {
+			delete[] storage;
+		}
+	}
+}
+
+Buffer_pool::Free_lists & Buffer_pool::local_free_lists() noexcept {
+	thread_local Free_lists free_lists;
+	return free_lists;
+}
+
+std::size_t Buffer_pool::size_class_index(const std::size_t capacity) noexcept {
+	return static_cast<std::size_t>(std::lower_bound(size_classes.begin(), size_classes.end(), capacity) - size_classes.begin());
+}
+
+std::size_t Buffer_pool::capacity_for(const std::size_t min_capacity) noexcept {
+	const auto class_index = size_class_index(min_capacity);
+	return class_index == size_classes.size() ? min_capacity : size_classes[class_index];
+}
+
+Buffer_pool::Buffer Buffer_pool::acquire(const std::size_t min_capacity) noexcept {
+	const auto class_index = size_class_index(min_capacity);
+
+	if(class_index == size_classes.size()) {
+		// larger than any class. served straight from the allocator and never cached
+		m_misses.fetch_add(1, std::memory_order_relaxed);
+		return Buffer(new char[min_capacity], min_capacity);
+	}
+
+	auto & free_list = local_free_lists().lists[class_index];
+
+	if(free_list.empty()) {
+		m_misses.fetch_add(1, std::memory_order_relaxed);
+		// deliberately not value-initialized. every byte is written by a read or an append before it is used
+		return Buffer(new char[size_classes[class_index]], size_classes[class_index]);
+	}
+
+	m_hits.fetch_add(1, std::memory_order_relaxed);
+
+	auto * storage = free_list.back();
+	free_list.pop_back();
+	return Buffer(storage, size_classes[class_index]);
+}
+
+void Buffer_pool::release(char * const storage, const std::size_t capacity) noexcept {
+	const auto class_index = size_class_index(capacity);
+
+	if(class_index == size_classes.size() || size_classes[class_index] != capacity) {
+		delete[] storage;
+		return;
+	}
+
+	auto & free_list = local_free_lists().lists[class_index];
+
+	if(free_list.size() < max_cached_per_class) {
+		free_list.push_back(storage);
+	} else {
+		delete[] storage;
+	}
+}
+
+void Buffer_pool::Buffer::reset() noexcept {
+
+	if(m_storage) {
+		release(m_storage, m_capacity);
+	}
+
+	m_storage = nullptr;
+	m_size = m_capacity = 0;
+}
+
+void Buffer_pool::Buffer::resize(const std::size_t new_size) noexcept {
+
+	if(new_size > m_capacity) {
+		auto grown = acquire(std::max(new_size, m_capacity * 2));
+
+		if(m_size) {
+			std::memcpy(grown.data(), m_storage, m_size);
+		}
+
+		grown.m_size = m_size;
+		swap(grown);
+	}
+
+	m_size = new_size;
+}
+
+void Buffer_pool::Buffer::append(const std::string_view content) noexcept {
+	const auto old_size = m_size;
+	resize(m_size + content.size());
+	std::memcpy(m_storage + old_size, content.data(), content.size());
+}
\ No newline at end of file
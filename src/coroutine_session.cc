@@ -0,0 +1,151 @@
+#include "coroutine_session.h"
+
+#if defined(ASIO_HAS_CO_AWAIT)
+
+#include "tcp_server.h"
+
+#include <asio/redirect_error.hpp>
+#include <asio/co_spawn.hpp>
+#include <asio/detached.hpp>
+#include <asio/error.hpp>
+#include <asio/write.hpp>
+#include <memory>
+
+void Coroutine_session::spawn(tcp_socket && socket, asio::ssl::context * const ssl_context, Tcp_server & server,
+					const std::uint64_t client_id) noexcept {
+	auto strand = socket.get_executor();
+	asio::co_spawn(strand, run(std::move(socket), ssl_context, server, client_id), asio::detached);
+}
+
+asio::awaitable<void, Coroutine_session::strand_type> Coroutine_session::run(tcp_socket socket, asio::ssl::context * const ssl_context,
+											   Tcp_server & server, const std::uint64_t client_id) {
+	Tcp_flush::configure(socket.native_handle(), server.m_options.flush_policy);
+
+	if(!ssl_context) {
+		co_await echo(socket, socket, server, client_id);
+		co_return;
+	}
+
+	ssl_tcp_socket ssl_socket(socket, *ssl_context);
+	steady_timer handshake_timer(socket.get_executor());
+	// the timeout may still be queued once the frame is gone. it touches the socket only while this is set
+	const auto handshake_pending = std::make_shared<bool>(true);
+	asio::error_code error_code;
+
+	// a client that connects and never finishes its handshake would hold its max_connections slot for good
+	if(server.m_options.handshake_timeout.count()) {
+		handshake_timer.expires_after(server.m_options.handshake_timeout);
+		handshake_timer.async_wait([handshake_pending, &socket, &server, client_id](const auto & error_code) {
+			if(!error_code && *handshake_pending) {
+				server.m_logger.error_log("handshake with client [", client_id, "] timed out");
+				asio::error_code cancel_code;
+				socket.cancel(cancel_code);
+			}
+		});
+	}
+
+	server.m_logger.server_log("handshake attempt with client [", client_id, ']');
+	co_await ssl_socket.async_handshake(asio::ssl::stream_base::handshake_type::server, asio::redirect_error(use_awaitable, error_code));
+	*handshake_pending = false;
+	handshake_timer.cancel();
+
+	if(error_code) {
+		// aborted by the handshake timeout, which logged it already
+		if(error_code != asio::error::operation_aborted) {
+			server.m_logger.error_log(error_code, error_code.message());
+		}
+
+		close(socket, server, client_id);
+		co_return;
+	}
+
+	server.m_logger.server_log("handshake successful with client [", client_id, ']');
+	co_await echo(ssl_socket, socket, server, client_id);
+}
+
+template <typename stream_type>
+asio::awaitable<void, Coroutine_session::strand_type> Coroutine_session::echo(stream_type & stream, tcp_socket & socket, Tcp_server & server,
+											    const std::uint64_t client_id) {
+	const auto streaming = server.m_options.echo_mode == Echo_mode::streaming;
+	Echo_policy echo_policy(server.m_options);
+	auto read_buffer = echo_policy.initial_read_buffer();
+	Buffer_pool::Buffer output;
+	asio::error_code error_code;
+
+	for(;;) {
+
+		if(echo_policy.adapt_read_buffer(read_buffer)) {
+			server.m_logger.server_log("read buffer of client [", client_id, "] resized to", read_buffer.capacity(), "bytes");
+		}
+
+		const auto bytes_read = co_await stream.async_read_some(asio::buffer(read_buffer.data(), read_buffer.capacity()),
+											  asio::redirect_error(use_awaitable, error_code));
+		const auto read_finished = Echo_policy::input_finished(error_code);
+
+		if(error_code && !read_finished) {
+			server.m_logger.error_log(error_code, error_code.message());
+			break;
+		}
+
+		server.m_logger.server_log("message received from client [", client_id, ']');
+		echo_policy.record_read(bytes_read, read_buffer.capacity());
+		const std::string_view content(read_buffer.data(), bytes_read);
+		std::string_view response;
+
+		if(streaming) {
+			server.m_logger.server_log("streaming message from client [", client_id, ']');
+			response = content;
+		} else {
+			server.m_logger.server_log("processing message from client [", client_id, ']');
+			server.m_logger.receive_log(client_id, content);
+			output.append(content);
+
+			if(read_finished || echo_policy.output_full(output.size())) {
+				response = std::string_view(output.data(), output.size());
+			}
+		}
+
+		// written right here rather than from a nested coroutine, whose frame would miss asio's one block frame cache
+		if(!response.empty()) {
+			echo_policy.begin_write(socket.native_handle(), response.size());
+			const auto bytes_sent = co_await asio::async_write(stream, asio::buffer(response.data(), response.size()),
+												 asio::redirect_error(use_awaitable, error_code));
+			// reads and writes take turns, so every write is a burst of its own
+			echo_policy.end_burst(socket.native_handle());
+
+			if(error_code) {
+				server.m_logger.error_log(error_code, error_code.message());
+				break;
+			}
+
+			server.m_logger.server_log(bytes_sent, "bytes sent to client [", client_id, ']');
+
+			if(!streaming) {
+				server.m_logger.send_log(client_id, response);
+				output.clear();
+			}
+		}
+
+		if(read_finished) {
+			break;
+		}
+	}
+
+	close(socket, server, client_id);
+}
+
+void Coroutine_session::close(tcp_socket & socket, Tcp_server & server, const std::uint64_t client_id) noexcept {
+	const auto sent = Tcp_flush::segment_counts(socket.native_handle());
+	server.on_segments_sent(sent);
+	server.m_logger.server_log("client [", client_id, "] was sent", sent.bytes, "bytes in", sent.data_segments, "data segments");
+
+	// a peer that already reset the connection fails the shutdown. the close still has to run
+	asio::error_code error_code;
+	socket.shutdown(tcp_socket::shutdown_both, error_code);
+	socket.close(error_code);
+
+	server.m_logger.server_log("connection closed with client [", client_id, ']');
+	server.on_session_closed(client_id);
+}
+
+#endif // ASIO_HAS_CO_AWAIT
@@ -0,0 +1,121 @@
+#include "cpu_budget.h"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <sched.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+
+std::size_t Cpu_budget::available_cpus() noexcept {
+	cpu_set_t cpu_set;
+
+	if(!::sched_getaffinity(0, sizeof(cpu_set), &cpu_set)) {
+		return static_cast<std::size_t>(CPU_COUNT(&cpu_set));
+	}
+
+	return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+std::size_t Cpu_budget::usable_cpus() noexcept {
+	const auto cpus = available_cpus();
+	std::int64_t quota = -1;
+	std::int64_t period = 0;
+
+	// v2 holds "quota period" with "max" for no quota. v1 splits them over two files with -1 for no quota
+	if(std::ifstream cpu_max(controller_file("cpu.max", nullptr)); cpu_max) {
+		std::string quota_field;
+		cpu_max >> quota_field >> period;
+
+		if(quota_field != "max") {
+			quota = std::strtoll(quota_field.c_str(), nullptr, 10);
+		}
+	} else {
+		std::ifstream(controller_file(nullptr, "cpu.cfs_quota_us")) >> quota;
+		std::ifstream(controller_file(nullptr, "cpu.cfs_period_us")) >> period;
+	}
+
+	if(quota <= 0 || period <= 0) {
+		return cpus;
+	}
+
+	const auto quota_cpus = static_cast<std::size_t>((quota + period - 1) / period);
+	return std::clamp<std::size_t>(quota_cpus, 1, cpus);
+}
+
+std::chrono::microseconds Cpu_budget::throttled_time() noexcept {
+
+	if(const auto throttled = stat_value(controller_file("cpu.stat", nullptr), "throttled_usec")) {
+		return std::chrono::microseconds(*throttled);
+	}
+
+	// v1 counts nanoseconds
+	const auto throttled = stat_value(controller_file(nullptr, "cpu.stat"), "throttled_time");
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::nanoseconds(throttled.value_or(0)));
+}
+
+std::chrono::nanoseconds Cpu_budget::run_delay(const pid_t thread_id) noexcept {
+	// cpu time, run delay and timeslice count, all of the thread alone
+	std::ifstream schedstat("/proc/self/task/" + std::to_string(thread_id) + "/schedstat");
+	std::uint64_t cpu_time = 0;
+	std::uint64_t delay = 0;
+	schedstat >> cpu_time >> delay;
+	return std::chrono::nanoseconds(delay);
+}
+
+pid_t Cpu_budget::current_thread_id() noexcept {
+	return static_cast<pid_t>(::syscall(SYS_gettid));
+}
+
+std::string Cpu_budget::controller_file(const char * const v2_name, const char * const v1_name) noexcept {
+	std::ifstream cgroups("/proc/self/cgroup");
+	std::string line;
+
+	// one "id:controllers:path" line per hierarchy. the v2 one has id 0 and no controllers
+	while(std::getline(cgroups, line)) {
+		const auto first_colon = line.find(':');
+		const auto second_colon = line.find(':', first_colon + 1);
+
+		if(first_colon == std::string::npos || second_colon == std::string::npos) {
+			continue;
+		}
+
+		const auto controllers = line.substr(first_colon + 1, second_colon - first_colon - 1);
+		const auto path = line.substr(second_colon + 1);
+		std::string candidates[2];
+
+		if(v2_name && controllers.empty()) {
+			candidates[0] = "/sys/fs/cgroup" + path + '/' + v2_name;
+			candidates[1] = std::string("/sys/fs/cgroup/") + v2_name;
+		} else if(v1_name && (controllers == "cpu" || controllers == "cpu,cpuacct" || controllers == "cpuacct,cpu")) {
+			candidates[0] = "/sys/fs/cgroup/" + controllers + path + '/' + v1_name;
+			candidates[1] = "/sys/fs/cgroup/" + controllers + '/' + v1_name;
+		} else {
+			continue;
+		}
+
+		// a container without its own cgroup namespace sees the host path of its cgroup mounted as the root
+		for(const auto & candidate : candidates) {
+			if(::access(candidate.c_str(), R_OK) == 0) {
+				return candidate;
+			}
+		}
+	}
+
+	return {};
+}
+
+std::optional<std::uint64_t> Cpu_budget::stat_value(const std::string & path, const std::string & key) noexcept {
+	std::ifstream stat(path);
+	std::string line_key;
+	std::uint64_t value = 0;
+
+	while(stat >> line_key >> value) {
+		if(line_key == key) {
+			return value;
+		}
+	}
+
+	return std::nullopt;
+}
@@ -0,0 +1,80 @@
+#include "echo_policy.h"
+#include "tcp_flush.h"
+
+#include <asio/error.hpp>
+#include <algorithm>
+
+Echo_policy::Echo_policy(const Server_options & options) noexcept : m_options(options) {
+}
+
+bool Echo_policy::input_finished(const asio::error_code & error_code) noexcept {
+	// read_some reports the close_notify on its own, without any payload
+	return error_code == asio::error::eof || error_code == asio::error::no_permission;
+}
+
+Buffer_pool::Buffer Echo_policy::initial_read_buffer() noexcept {
+	m_read_size_sum = m_options.min_read_buffer * read_average_weight;
+	m_read_filled = false;
+	return Buffer_pool::acquire(m_options.min_read_buffer);
+}
+
+void Echo_policy::record_read(const std::size_t bytes_read, const std::size_t buffer_capacity) noexcept {
+	m_read_size_sum = m_read_size_sum - m_read_size_sum / read_average_weight + bytes_read;
+	m_read_filled = bytes_read == buffer_capacity;
+}
+
+// the read buffer only ever changes between reads. everything read so far has been copied into the output by then
+bool Echo_policy::adapt_read_buffer(Buffer_pool::Buffer & read_buffer) noexcept {
+	const auto capacity = read_buffer.capacity();
+	const auto average_read_size = m_read_size_sum / read_average_weight;
+	auto wanted_capacity = capacity;
+
+	if(m_read_filled) {
+		// the kernel had more than fit. a bulk sender climbs one size class per full read
+		wanted_capacity = capacity * 2;
+	} else if(average_read_size * 4 <= capacity) {
+		// an interactive client gives memory back once its reads stay well below the buffer, not on the first short one
+		wanted_capacity = average_read_size * 2;
+	}
+
+	wanted_capacity = std::clamp(wanted_capacity, m_options.min_read_buffer, m_options.max_read_buffer);
+
+	if(Buffer_pool::capacity_for(wanted_capacity) == capacity) {
+		return false;
+	}
+
+	read_buffer = Buffer_pool::acquire(wanted_capacity);
+
+	if(m_read_filled) {
+		// counts as a bulk sender from here on. only a run of short reads brings the buffer back down
+		m_read_size_sum = read_buffer.capacity() / 2 * read_average_weight;
+	}
+
+	m_read_filled = false;
+	return true;
+}
+
+bool Echo_policy::output_full(const std::size_t queued_output) const noexcept {
+	return queued_output >= m_options.output_high_watermark;
+}
+
+bool Echo_policy::output_drained(const std::size_t queued_output) const noexcept {
+	return queued_output <= m_options.output_low_watermark;
+}
+
+void Echo_policy::begin_write(const int socket_fd, const std::size_t write_size) noexcept {
+
+	if(!m_corked && Tcp_flush::should_cork(m_options.flush_policy, write_size)) {
+		Tcp_flush::cork(socket_fd, true);
+		m_corked = true;
+	}
+}
+
+void Echo_policy::end_burst(const int socket_fd) noexcept {
+
+	if(m_corked) {
+		// uncorking pushes out the partial segment the cork held back
+		Tcp_flush::cork(socket_fd, false);
+		m_corked = false;
+	}
+}
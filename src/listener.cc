@@ -0,0 +1,143 @@
+#include "listener.h"
+
+#include <asio/bind_executor.hpp>
+#include <asio/error.hpp>
+#include <asio/post.hpp>
+#include <asio/steady_timer.hpp>
+#include <asio/strand.hpp>
+#include <algorithm>
+#include <memory>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+
+Tcp_server::Listener::Listener(Tcp_server & server, Shard & shard) noexcept : m_server(server), m_shard(shard) {
+}
+
+bool Tcp_server::Listener::out_of_resources(const int error) noexcept {
+	return error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM;
+}
+
+void Tcp_server::Listener::back_off() noexcept {
+	auto backoff_timer = std::make_shared<asio::steady_timer>(m_shard.accept_strand, accept_backoff);
+
+	backoff_timer->async_wait([this, backoff_timer](const auto & error_code) {
+		if(!error_code && m_server.m_server_running) {
+			rearm();
+		}
+	});
+}
+
+void Tcp_server::Reactor_listener::listen() noexcept {
+
+	asio::post(m_shard.accept_strand, [this] {
+		const auto accepts_in_flight = std::max<std::size_t>(m_server.m_options.accepts_per_worker, 1) *
+						       (m_server.m_shards.size() > 1 ? 1 : m_server.m_thread_count);
+
+		asio::error_code error_code;
+		m_shard.acceptor.listen(m_server.m_options.listen_backlog, error_code);
+
+		if(!error_code) {
+			// lets the draining loop find the queue empty instead of blocking on it. the accepts in flight are unaffected
+			m_shard.acceptor.non_blocking(true, error_code);
+		}
+
+		if(error_code) {
+			m_server.m_logger.error_log(error_code, error_code.message());
+			return;
+		}
+
+		m_server.m_logger.server_log("listening state. backlog of", m_server.m_options.listen_backlog, "with", accepts_in_flight,
+						     "accepts in flight");
+
+		for(std::size_t i = 0; i < accepts_in_flight; i++) {
+			accept();
+		}
+	});
+}
+
+// stays armed whatever the load. admission is decided per connection once it is accepted. only running out of
+// descriptors or memory pauses it for a while
+void Tcp_server::Reactor_listener::accept() noexcept {
+	auto on_connection_attempt = [this](const auto & error_code, tcp_socket socket) {
+		if(!error_code) {
+			m_server.create_session(m_shard, std::move(socket));
+			drain_accept_queue();
+			accept();
+		} else if(error_code.category() == asio::system_category() && out_of_resources(error_code.value())) {
+			// the connection stays queued in the backlog until a descriptor frees up
+			m_server.m_logger.error_log(error_code, error_code.message(), ". accepting again in", accept_backoff.count(), "ms");
+			back_off();
+		} else if(error_code != asio::error::operation_aborted) {
+			m_server.m_logger.error_log(error_code, error_code.message());
+			// socket could not connect - no shutdown required
+		}
+	};
+
+	// every connection gets its own strand so its handlers are serialized without any server-wide lock
+	m_shard.acceptor.async_accept(asio::make_strand(m_shard.io_context), asio::bind_executor(m_shard.accept_strand, on_connection_attempt));
+}
+
+void Tcp_server::Reactor_listener::rearm() noexcept {
+	accept();
+}
+
+// whatever queued up behind the connection just accepted is taken now rather than one reactor wakeup at a time
+void Tcp_server::Reactor_listener::drain_accept_queue() noexcept {
+
+	for(std::size_t i = 0; i < accept_batch_size; i++) {
+		asio::error_code error_code;
+		auto socket = m_shard.acceptor.accept(asio::make_strand(m_shard.io_context), error_code);
+
+		if(error_code) {
+			if(error_code != asio::error::would_block && error_code != asio::error::try_again) {
+				m_server.m_logger.error_log(error_code, error_code.message());
+			}
+
+			return;
+		}
+
+		m_server.create_session(m_shard, std::move(socket));
+	}
+}
+
+void Tcp_server::Uring_listener::listen() noexcept {
+	m_shard.acceptor.listen(m_server.m_options.listen_backlog);
+	m_server.m_logger.server_log("listening state.", m_shard.uring->multishot_accept() ? "multishot" : "single shot",
+					     "accepts through io_uring");
+	m_shard.uring->accept(m_shard.acceptor.native_handle(), *this);
+}
+
+void Tcp_server::Uring_listener::complete(const int result, const bool more) noexcept {
+
+	if(result >= 0) {
+
+		if(!m_server.m_server_running) {
+			::close(result);
+		} else {
+			// kept out of the reactor, which would wake a worker on every packet for nothing
+			m_server.create_session(m_shard, tcp_socket(asio::make_strand(m_shard.io_context)), result);
+		}
+	} else if(result == -EINVAL && m_shard.uring->multishot_accept()) {
+		m_server.m_logger.server_log("kernel has no multishot accept. one accept request per connection from now on");
+		m_shard.uring->disable_multishot_accept();
+	} else if(out_of_resources(-result)) {
+		m_server.m_logger.error_log("accept failed :", std::strerror(-result), ". accepting again in", accept_backoff.count(), "ms");
+
+		if(!more) {
+			back_off();
+		}
+
+		return;
+	} else if(result != -ECANCELED) {
+		m_server.m_logger.error_log("accept failed :", std::strerror(-result));
+	}
+
+	if(!more && m_server.m_server_running && result != -ECANCELED) {
+		rearm();
+	}
+}
+
+void Tcp_server::Uring_listener::rearm() noexcept {
+	m_shard.uring->accept(m_shard.acceptor.native_handle(), *this);
+}
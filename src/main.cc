@@ -4,11 +4,10 @@
 #include <string>
 
 int main() {
-	constexpr auto thread_count = 3;
 	constexpr auto listen_port = 1234;
 	constexpr std::string_view auth_dir("../certs/");
 
-	Tcp_server server(thread_count, listen_port, auth_dir);
+	Tcp_server server(Tcp_server::automatic_thread_count, listen_port, auth_dir);
 	server.start();
 
 	// emulate
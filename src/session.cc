@@ -0,0 +1,280 @@
+#include "session.h"
+#include "session_io.h"
+#include "tcp_server.h"
+
+#include <asio/error.hpp>
+#include <asio/post.hpp>
+#include <algorithm>
+
+Session::Session(tcp_socket && socket, Tcp_server & server, const std::uint64_t client_id)
+    : m_socket(std::move(socket)), m_handshake_timer(m_socket.get_executor()), m_server(server), m_echo_policy(server.m_options),
+	m_client_id(client_id) {
+
+	if(m_server.m_options.zerocopy_threshold) {
+		m_io = std::make_unique<Zerocopy_io>(*this);
+	} else {
+		m_io = std::make_unique<Reactor_io>(*this);
+	}
+}
+
+Session::Session(tcp_socket && socket, Uring_backend & uring, const int uring_fd, Tcp_server & server, const std::uint64_t client_id)
+    : m_socket(std::move(socket)), m_handshake_timer(m_socket.get_executor()), m_server(server),
+	m_io(std::make_unique<Uring_io>(*this, uring, uring_fd)),
+	m_echo_policy(server.m_options), m_client_id(client_id) {
+}
+
+Session::Session(tcp_socket && socket, asio::ssl::context & ssl_context, Tcp_server & server, const std::uint64_t client_id)
+    : m_socket(std::move(socket)), m_handshake_timer(m_socket.get_executor()), m_server(server), m_echo_policy(server.m_options),
+	m_client_id(client_id) {
+
+	if(m_server.m_options.kernel_tls || m_server.m_options.compact_tls) {
+		// kernel tls needs openssl on the socket itself. compact tls drops asio's stream buffers the same way
+		m_io = std::make_unique<Socket_tls_io>(*this, ssl_context);
+	} else {
+		m_io = std::make_unique<Asio_tls_io>(*this, ssl_context);
+	}
+}
+
+Session::~Session() = default;
+
+void Session::start() noexcept {
+	Tcp_flush::configure(m_io->native_handle(), m_server.m_options.flush_policy);
+
+	// a client that connects and never finishes its handshake would hold its max_connections slot for good
+	if(m_server.m_options.transport == Transport::tls && m_server.m_options.handshake_timeout.count()) {
+		m_handshake_timer.expires_after(m_server.m_options.handshake_timeout);
+		m_handshake_timer.async_wait(bind_handler_memory([self = shared_from_this()](const auto & error_code) {
+			// a timeout already queued when the echo started finds the expiry pushed out
+			if(!error_code && self->m_handshake_timer.expiry() <= std::chrono::steady_clock::now()) {
+				self->m_server.m_logger.error_log("handshake with client [", self->m_client_id, "] timed out");
+				self->shutdown_socket();
+			}
+		}));
+	}
+
+	// the only hop through the queue. the accepting thread goes straight back to accepting instead of running the handshake
+	asio::post(m_socket.get_executor(), bind_handler_memory([self = shared_from_this()] { self->m_io->handshake(); }));
+}
+
+void Session::start_echo() noexcept {
+	m_handshake_timer.expires_at(steady_timer::time_point::max());
+	m_read_buffer = m_echo_policy.initial_read_buffer();
+	m_io->read_buffer_replaced();
+	read_message();
+}
+
+void Session::shutdown_socket() noexcept {
+
+	if(m_closed) {
+		return;
+	}
+
+	m_closed = true;
+	m_handshake_timer.cancel();
+
+	const auto sent = Tcp_flush::segment_counts(m_io->native_handle());
+	m_server.on_segments_sent(sent);
+	m_server.m_logger.server_log("client [", m_client_id, "] was sent", sent.bytes, "bytes in", sent.data_segments, "data segments");
+
+	m_io->close();
+	m_server.m_logger.server_log("connection closed with client [", m_client_id, ']');
+
+	m_server.on_session_closed(m_client_id);
+}
+
+void Session::close_when_sent() noexcept {
+
+	if(!m_io->defer_close()) {
+		shutdown_socket();
+	}
+}
+
+std::size_t Session::queued_output_size() const noexcept {
+	return m_pending_output.size() + m_inflight_output.size();
+}
+
+void Session::respond(const std::string_view response) noexcept {
+	queue_response(response);
+	flush_responses();
+}
+
+void Session::queue_response(const std::string_view response) noexcept {
+	// whatever is queued while a write is in flight coalesces into one contiguous buffer. asio::ssl::stream only hands the
+	// first buffer of a sequence to SSL_write so a gathered buffer sequence would still cost one record and one send per echo
+	m_pending_output.append(response);
+}
+
+void Session::flush_responses() noexcept {
+
+	if(m_write_in_progress || m_pending_output.empty()) {
+		return;
+	}
+
+	// single outstanding write per session. the buffer being written is never touched until it completes
+	m_pending_output.swap(m_inflight_output);
+	m_write_in_progress = true;
+
+	m_echo_policy.begin_write(m_io->native_handle(), m_inflight_output.size());
+	m_io->write();
+}
+
+void Session::complete_write(const asio::error_code & error_code, const std::size_t bytes_sent) noexcept {
+	m_write_in_progress = false;
+
+	if(error_code) {
+		if(error_code != asio::error::operation_aborted) {
+			m_server.m_logger.error_log(error_code, error_code.message());
+		}
+
+		shutdown_socket();
+		return;
+	}
+
+	m_server.m_logger.server_log(bytes_sent, "bytes sent to client [", m_client_id, ']');
+
+	if(m_server.m_options.echo_mode == Echo_mode::buffered) {
+		m_server.m_logger.send_log(m_client_id, std::string_view(m_inflight_output.data(), m_inflight_output.size()));
+	}
+
+	m_io->release_output(m_inflight_output);
+	flush_responses();
+
+	if(!m_write_in_progress) {
+		m_echo_policy.end_burst(m_io->native_handle());
+	}
+
+	if(m_read_finished) {
+		if(!m_write_in_progress) {
+			close_when_sent();
+		}
+	} else if(m_read_paused && m_echo_policy.output_drained(queued_output_size())) {
+		m_server.m_logger.server_log("output drained for client [", m_client_id, "]. reads resumed");
+		m_read_paused = false;
+		read_message();
+	}
+}
+
+void Session::handle_message(const std::string_view content, const asio::error_code & connection_code) noexcept {
+
+	if(m_server.m_options.echo_mode == Echo_mode::streaming) {
+		stream_message(content, connection_code);
+	} else {
+		process_message(content, connection_code);
+	}
+}
+
+// the session issues no read while its message is in the stage, so messages leave the stage in the order they arrived
+void Session::stage_message(const std::string_view content, const asio::error_code & connection_code) noexcept {
+	// a copy rather than the read buffer itself. an io_uring session has the read buffer registered with the kernel
+	m_staged_message = Buffer_pool::acquire(content.size());
+	m_staged_message.append(content);
+	m_staged_connection_code = connection_code;
+
+	if(!m_server.m_compute_pool) {
+		m_server.m_options.message_stage(m_staged_message);
+		complete_stage();
+		return;
+	}
+
+	// the result goes back through the backend. an io_uring session completes on the ring thread, not on its strand
+	asio::post(*m_server.m_compute_pool, bind_handler_memory([self = shared_from_this()] {
+		self->m_server.m_options.message_stage(self->m_staged_message);
+		self->m_io->complete_stage();
+	}));
+}
+
+void Session::complete_stage() noexcept {
+	const auto message = std::move(m_staged_message);
+
+	// a write failure can close the session while its message is away
+	if(!m_closed) {
+		handle_message(std::string_view(message.data(), message.size()), m_staged_connection_code);
+	}
+}
+
+void Session::process_message(const std::string_view content, const asio::error_code & connection_code) noexcept {
+	m_server.m_logger.server_log("processing message from client [", m_client_id, ']');
+	m_server.m_logger.receive_log(m_client_id, content);
+
+	// the read buffer is reused by the next read so the content is copied out
+	queue_response(content);
+
+	if(connection_code) {
+		m_read_finished = true;
+
+		if(m_pending_output.empty()) {
+			close_when_sent();
+		} else {
+			flush_responses();
+		}
+	} else {
+		if(m_echo_policy.output_full(queued_output_size())) {
+			// a message larger than the high watermark is echoed in pieces rather than held in memory whole
+			flush_responses();
+		}
+
+		continue_reading();
+	}
+}
+
+void Session::stream_message(const std::string_view content, const asio::error_code & connection_code) noexcept {
+	m_server.m_logger.server_log("streaming message from client [", m_client_id, ']');
+	respond(content);
+
+	if(connection_code) {
+		m_read_finished = true;
+
+		if(!m_write_in_progress) {
+			close_when_sent();
+		}
+	} else {
+		continue_reading();
+	}
+}
+
+void Session::continue_reading() noexcept {
+
+	if(!m_echo_policy.output_full(queued_output_size())) {
+		read_message();
+		return;
+	}
+
+	// a client that does not read its echoes stops being read from. the write completion resumes reading once the
+	// backlog drains down to the low watermark
+	m_read_paused = true;
+	m_server.m_logger.server_log("output backlog of", queued_output_size(), "bytes for client [", m_client_id, "]. reads paused");
+}
+
+// every stage below runs on the session strand and continues into the next one directly. nothing is re-posted since each
+// completion already arrives through the scheduler queue, so no session can monopolize a worker
+void Session::read_message() noexcept {
+	const auto capacity = m_read_buffer.capacity();
+
+	if(m_echo_policy.adapt_read_buffer(m_read_buffer)) {
+		m_server.m_logger.server_log("read buffer of client [", m_client_id, "] resized from", capacity, "to", m_read_buffer.capacity(), "bytes");
+		m_io->read_buffer_replaced();
+	}
+
+	m_io->read();
+}
+
+void Session::complete_read(const asio::error_code & error_code, const std::size_t bytes_read) noexcept {
+	if((bytes_read && !error_code) || Echo_policy::input_finished(error_code)) {
+		m_server.m_logger.server_log("message received from client [", m_client_id, ']');
+		m_echo_policy.record_read(bytes_read, m_read_buffer.capacity());
+
+		const std::string_view content(m_read_buffer.data(), bytes_read);
+
+		if(m_server.m_options.message_stage) {
+			stage_message(content, error_code);
+		} else {
+			handle_message(content, error_code);
+		}
+	} else {
+		if(error_code != asio::error::operation_aborted) {
+			m_server.m_logger.error_log(error_code, error_code.message());
+		}
+
+		shutdown_socket();
+	}
+}
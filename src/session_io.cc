@@ -0,0 +1,515 @@
+#include "session_io.h"
+#include "tcp_server.h"
+
+#include <asio/error.hpp>
+#include <asio/post.hpp>
+#include <asio/write.hpp>
+#include <asio/ssl/error.hpp>
+#include <openssl/err.h>
+#include <linux/errqueue.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <cerrno>
+
+Session::Io::Io(Session & session) noexcept : m_session(session) {
+}
+
+void Session::Io::handshake() noexcept {
+	m_session.start_echo();
+}
+
+void Session::Io::complete_stage() noexcept {
+	asio::post(m_session.m_socket.get_executor(),
+		     m_session.bind_handler_memory([self = m_session.shared_from_this()] { self->complete_stage(); }));
+}
+
+void Session::Io::read_buffer_replaced() noexcept {
+}
+
+void Session::Io::release_output(Buffer_pool::Buffer & output) noexcept {
+	// keeps the capacity for the next flush
+	output.clear();
+}
+
+bool Session::Io::defer_close() noexcept {
+	return false;
+}
+
+void Session::Reactor_io::read() noexcept {
+	m_session.m_socket.async_read_some(asio::buffer(m_session.m_read_buffer.data(), m_session.m_read_buffer.capacity()),
+					       m_session.bind_handler_memory([self = m_session.shared_from_this()](const auto & error_code, const auto bytes_read) {
+						       self->complete_read(error_code, bytes_read);
+					       }));
+}
+
+void Session::Reactor_io::write() noexcept {
+	const auto & output = m_session.m_inflight_output;
+
+	asio::async_write(m_session.m_socket, asio::buffer(output.data(), output.size()),
+				m_session.bind_handler_memory([self = m_session.shared_from_this()](const auto & error_code, const auto bytes_sent) {
+					self->complete_write(error_code, bytes_sent);
+				}));
+}
+
+void Session::Reactor_io::close() noexcept {
+	// a peer that already reset the connection fails the shutdown
+	asio::error_code error_code;
+	m_session.m_socket.shutdown(tcp_socket::shutdown_both, error_code);
+	m_session.m_socket.close(error_code);
+}
+
+int Session::Reactor_io::native_handle() const noexcept {
+	return m_session.m_socket.native_handle();
+}
+
+void Session::Zerocopy_io::handshake() noexcept {
+	const int enable = 1;
+
+	if(::setsockopt(native_handle(), SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable))) {
+		m_session.m_server.m_logger.error_log("zerocopy unavailable for client [", m_session.m_client_id, "] :", std::strerror(errno));
+	} else {
+		m_enabled = true;
+	}
+
+	Io::handshake();
+}
+
+void Session::Zerocopy_io::write() noexcept {
+
+	if(m_enabled && m_session.m_inflight_output.size() >= m_session.m_server.m_options.zerocopy_threshold) {
+		send(0);
+	} else {
+		Reactor_io::write();
+	}
+}
+
+void Session::Zerocopy_io::send(std::size_t offset) noexcept {
+	const auto & output = m_session.m_inflight_output;
+
+	while(offset < output.size()) {
+		const auto sent = ::send(native_handle(), output.data() + offset, output.size() - offset, MSG_ZEROCOPY | MSG_DONTWAIT | MSG_NOSIGNAL);
+
+		if(sent >= 0) {
+			// the kernel numbers every successful zerocopy send. completions later report ranges of these numbers
+			++m_sends;
+			offset += static_cast<std::size_t>(sent);
+		} else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+			m_session.m_socket.async_wait(tcp_socket::wait_write,
+							    m_session.bind_handler_memory([self = m_session.shared_from_this(), this, offset](const auto & error_code) {
+								    if(error_code) {
+									    self->complete_write(error_code, offset);
+								    } else {
+									    send(offset);
+								    }
+							    }));
+			return;
+		} else if(errno == ENOBUFS) {
+			// out of option memory for pinned pages. the rest goes out through the regular copying path
+			asio::async_write(m_session.m_socket, asio::buffer(output.data() + offset, output.size() - offset),
+						m_session.bind_handler_memory([self = m_session.shared_from_this(), offset](const auto & error_code, const auto bytes_sent) {
+							self->complete_write(error_code, offset + bytes_sent);
+						}));
+			return;
+		} else {
+			m_session.complete_write(asio::error_code(errno, asio::error::get_system_category()), offset);
+			return;
+		}
+	}
+
+	m_session.complete_write({}, offset);
+}
+
+void Session::Zerocopy_io::release_output(Buffer_pool::Buffer & output) noexcept {
+
+	if(m_sends == m_held_upto) {
+		Io::release_output(output);
+		return;
+	}
+
+	// pages of this buffer are still referenced by the kernel. it returns to the pool once the completion arrives
+	m_held_buffers.push_back({std::move(output), m_sends});
+	m_held_upto = m_sends;
+	reap_completions();
+}
+
+bool Session::Zerocopy_io::defer_close() noexcept {
+
+	if(m_held_buffers.empty()) {
+		return false;
+	}
+
+	// closing now could send recycled memory
+	m_close_pending = true;
+	reap_completions();
+	return true;
+}
+
+void Session::Zerocopy_io::reap_completions() noexcept {
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(sock_extended_err))];
+	msghdr message{};
+
+	for(;;) {
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+
+		if(::recvmsg(native_handle(), &message, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+			break;
+		}
+
+		for(auto * header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+			const auto is_recverr = (header->cmsg_level == SOL_IP && header->cmsg_type == IP_RECVERR) ||
+						     (header->cmsg_level == SOL_IPV6 && header->cmsg_type == IPV6_RECVERR);
+
+			if(!is_recverr) {
+				continue;
+			}
+
+			const auto * error = reinterpret_cast<const sock_extended_err *>(CMSG_DATA(header));
+
+			if(error->ee_origin == SO_EE_ORIGIN_ZEROCOPY && !error->ee_errno) {
+				// ee_info to ee_data is an inclusive range of completed send numbers
+				m_completed = std::max(m_completed, error->ee_data + 1);
+			}
+		}
+	}
+
+	const auto released = std::find_if(m_held_buffers.begin(), m_held_buffers.end(),
+	                                   [this](const auto & held) { return held.sends_upto > m_completed; });
+	m_held_buffers.erase(m_held_buffers.begin(), released);
+
+	if(m_held_buffers.empty()) {
+		if(m_close_pending) {
+			m_session.shutdown_socket();
+		}
+
+		return;
+	}
+
+	if(m_wait_armed || m_session.m_closed) {
+		return;
+	}
+
+	// edge triggered. a completion that slipped in before the wait was armed is drained right after arming
+	m_wait_armed = true;
+
+	m_session.m_socket.async_wait(tcp_socket::wait_error,
+					    m_session.bind_handler_memory([self = m_session.shared_from_this(), this](const auto & error_code) {
+						    m_wait_armed = false;
+
+						    if(!error_code) {
+							    reap_completions();
+						    }
+					    }));
+
+	reap_completions();
+}
+
+Session::Asio_tls_io::Asio_tls_io(Session & session, asio::ssl::context & ssl_context) noexcept
+    : Reactor_io(session), m_ssl_socket(session.m_socket, ssl_context) {
+}
+
+void Session::Asio_tls_io::handshake() noexcept {
+
+	auto on_handshake = [self = m_session.shared_from_this()](const auto & error_code) {
+		if(!error_code) {
+			self->m_server.m_logger.server_log("handshake successful with client [", self->m_client_id, ']');
+			self->start_echo();
+		} else {
+			// aborted by the handshake timeout, which logged it already
+			if(error_code != asio::error::operation_aborted) {
+				self->m_server.m_logger.error_log(error_code, error_code.message());
+			}
+
+			self->shutdown_socket();
+		}
+	};
+
+	m_session.m_server.m_logger.server_log("handshake attempt with client [", m_session.m_client_id, ']');
+	m_ssl_socket.async_handshake(asio::ssl::stream_base::handshake_type::server, m_session.bind_handler_memory(on_handshake));
+}
+
+void Session::Asio_tls_io::read() noexcept {
+	m_ssl_socket.async_read_some(asio::buffer(m_session.m_read_buffer.data(), m_session.m_read_buffer.capacity()),
+					     m_session.bind_handler_memory([self = m_session.shared_from_this()](const auto & error_code, const auto bytes_read) {
+						     self->complete_read(error_code, bytes_read);
+					     }));
+}
+
+void Session::Asio_tls_io::write() noexcept {
+	const auto & output = m_session.m_inflight_output;
+
+	asio::async_write(m_ssl_socket, asio::buffer(output.data(), output.size()),
+				m_session.bind_handler_memory([self = m_session.shared_from_this()](const auto & error_code, const auto bytes_sent) {
+					self->complete_write(error_code, bytes_sent);
+				}));
+}
+
+Session::Socket_tls_io::Socket_tls_io(Session & session, asio::ssl::context & ssl_context) noexcept
+    : Reactor_io(session), m_ssl(SSL_new(ssl_context.native_handle())) {
+}
+
+template <typename continuation_type>
+bool Session::Socket_tls_io::wait(const int ssl_error, continuation_type continuation) {
+
+	if(ssl_error != SSL_ERROR_WANT_READ && ssl_error != SSL_ERROR_WANT_WRITE) {
+		return false;
+	}
+
+	const auto wait_type = ssl_error == SSL_ERROR_WANT_READ ? tcp_socket::wait_read : tcp_socket::wait_write;
+
+	m_session.m_socket.async_wait(wait_type, m_session.bind_handler_memory([self = m_session.shared_from_this(), this, continuation](const auto & error_code) {
+		if(error_code) {
+			// aborted once the session closed the socket itself
+			if(error_code != asio::error::operation_aborted) {
+				self->m_server.m_logger.error_log(error_code, error_code.message());
+			}
+
+			self->shutdown_socket();
+		} else {
+			continuation(*this);
+		}
+	}));
+
+	return true;
+}
+
+void Session::Socket_tls_io::handshake() noexcept {
+	auto & logger = m_session.m_server.m_logger;
+	const auto client_id = m_session.m_client_id;
+
+	if(!m_ssl) {
+		logger.error_log("could not create a tls session for client [", client_id, ']');
+		m_session.shutdown_socket();
+		return;
+	}
+
+	if(!m_started) {
+		m_started = true;
+		logger.server_log("handshake attempt with client [", client_id, ']');
+
+		asio::error_code error_code;
+		m_session.m_socket.non_blocking(true, error_code);
+
+		// the bio does not own the descriptor. the socket still closes it
+		if(error_code || !SSL_set_fd(m_ssl.get(), native_handle())) {
+			logger.error_log("could not attach the tls session to client [", client_id, ']');
+			m_session.shutdown_socket();
+			return;
+		}
+
+		SSL_set_mode(m_ssl.get(), SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+	}
+
+	ERR_clear_error();
+	const auto result = SSL_accept(m_ssl.get());
+
+	if(result == 1) {
+		logger.server_log("handshake successful with client [", client_id, ']');
+#ifndef OPENSSL_NO_KTLS
+		const bool send_offloaded = BIO_get_ktls_send(SSL_get_wbio(m_ssl.get()));
+		const bool receive_offloaded = BIO_get_ktls_recv(SSL_get_rbio(m_ssl.get()));
+#else
+		const bool send_offloaded = false;
+		const bool receive_offloaded = false;
+#endif
+		logger.server_log("kernel tls for client [", client_id, "] send :", send_offloaded ? "on" : "off", "receive :",
+					receive_offloaded ? "on" : "off");
+		m_session.start_echo();
+		return;
+	}
+
+	const auto ssl_error = SSL_get_error(m_ssl.get(), result);
+
+	if(!wait(ssl_error, [](auto & io) { io.handshake(); })) {
+		const auto error_code = error(ssl_error);
+		logger.error_log(error_code, error_code.message());
+		m_session.shutdown_socket();
+	}
+}
+
+void Session::Socket_tls_io::read() noexcept {
+
+	// a record openssl already holds would never raise the socket readable again
+	if(!SSL_has_pending(m_ssl.get())) {
+		// an idle connection holds no read buffer while it waits
+		m_parked_read_capacity = m_session.m_read_buffer.capacity();
+		m_session.m_read_buffer = Buffer_pool::Buffer();
+		wait(SSL_ERROR_WANT_READ, [](auto & io) { io.receive(); });
+	} else {
+		asio::post(m_session.m_socket.get_executor(),
+			     m_session.bind_handler_memory([self = m_session.shared_from_this(), this] { receive(); }));
+	}
+}
+
+void Session::Socket_tls_io::receive() noexcept {
+	auto & read_buffer = m_session.m_read_buffer;
+	std::size_t bytes_read = 0;
+
+	if(!read_buffer.capacity()) {
+		read_buffer = Buffer_pool::acquire(m_parked_read_capacity);
+	}
+
+	ERR_clear_error();
+	const auto result = SSL_read_ex(m_ssl.get(), read_buffer.data(), read_buffer.capacity(), &bytes_read);
+
+	if(result == 1) {
+		m_session.complete_read({}, bytes_read);
+		return;
+	}
+
+	const auto ssl_error = SSL_get_error(m_ssl.get(), result);
+
+	if(!wait(ssl_error, [](auto & io) { io.receive(); })) {
+		m_session.complete_read(error(ssl_error), 0);
+	}
+}
+
+void Session::Socket_tls_io::write() noexcept {
+	send(0);
+}
+
+void Session::Socket_tls_io::send(std::size_t offset) noexcept {
+	const auto & output = m_session.m_inflight_output;
+
+	while(offset < output.size()) {
+		std::size_t bytes_sent = 0;
+
+		ERR_clear_error();
+		const auto result = SSL_write_ex(m_ssl.get(), output.data() + offset, output.size() - offset, &bytes_sent);
+
+		if(result == 1) {
+			offset += bytes_sent;
+			continue;
+		}
+
+		const auto ssl_error = SSL_get_error(m_ssl.get(), result);
+
+		if(!wait(ssl_error, [offset](auto & io) { io.send(offset); })) {
+			m_session.complete_write(error(ssl_error), offset);
+		}
+
+		return;
+	}
+
+	m_session.complete_write({}, offset);
+}
+
+asio::error_code Session::Socket_tls_io::error(const int ssl_error) const noexcept {
+
+	switch(ssl_error) {
+		case SSL_ERROR_ZERO_RETURN:
+			return asio::error::eof;
+		case SSL_ERROR_SYSCALL:
+			return errno ? asio::error_code(errno, asio::error::get_system_category()) : asio::ssl::error::stream_truncated;
+		default:
+			break;
+	}
+
+	const auto error = ERR_get_error();
+
+	if(ERR_GET_REASON(error) == SSL_R_UNEXPECTED_EOF_WHILE_READING) {
+		return asio::ssl::error::stream_truncated;
+	}
+
+	return asio::error_code(static_cast<int>(error), asio::error::get_ssl_category());
+}
+
+Session::Uring_io::Uring_io(Session & session, Uring_backend & uring, const int fd) noexcept
+    : Io(session), m_uring(uring), m_fd(fd) {
+}
+
+Session::Uring_io::Request::Request(Uring_io & io, void (Uring_io::*on_complete)(int result) noexcept) noexcept
+    : io(io), on_complete(on_complete) {
+}
+
+void Session::Uring_io::Request::complete(const int result, bool) noexcept {
+	// released before the callback so the callback can submit the next request through the same object
+	const auto self = std::move(session);
+	(io.*on_complete)(result);
+}
+
+// one read, one write and one staged message at most, all completing on the ring thread. that serializes the session
+void Session::Uring_io::read() noexcept {
+	m_read.session = m_session.shared_from_this();
+	m_uring.receive(m_fd, m_session.m_read_buffer.data(), m_session.m_read_buffer.capacity(), m_buffer_index, m_read);
+}
+
+void Session::Uring_io::write() noexcept {
+	m_sent = 0;
+	send();
+}
+
+void Session::Uring_io::send() noexcept {
+	const auto & output = m_session.m_inflight_output;
+	m_write.session = m_session.shared_from_this();
+	m_uring.send(m_fd, output.data() + m_sent, output.size() - m_sent, m_write);
+}
+
+void Session::Uring_io::close() noexcept {
+	// the shutdown completes a receive still in flight. its request holds the file until then
+	::shutdown(m_fd, SHUT_RDWR);
+	::close(m_fd);
+	m_uring.unregister_buffer(m_buffer_index);
+	m_buffer_index = -1;
+}
+
+int Session::Uring_io::native_handle() const noexcept {
+	return m_fd;
+}
+
+void Session::Uring_io::complete_stage() noexcept {
+	m_stage.session = m_session.shared_from_this();
+	m_uring.post(m_stage);
+}
+
+void Session::Uring_io::read_buffer_replaced() noexcept {
+	m_uring.unregister_buffer(m_buffer_index);
+	m_buffer_index = m_uring.register_buffer(m_session.m_read_buffer.data(), m_session.m_read_buffer.capacity());
+}
+
+void Session::Uring_io::complete_read(const int result) noexcept {
+
+	if(m_session.m_closed) {
+		return;
+	}
+
+	if(result > 0) {
+		m_session.complete_read({}, static_cast<std::size_t>(result));
+	} else if(!result) {
+		m_session.complete_read(asio::error::eof, 0);
+	} else {
+		m_session.complete_read(error(result), 0);
+	}
+}
+
+void Session::Uring_io::complete_write(const int result) noexcept {
+
+	if(m_session.m_closed) {
+		return;
+	}
+
+	if(result < 0) {
+		m_session.complete_write(error(result), m_sent);
+		return;
+	}
+
+	m_sent += static_cast<std::size_t>(result);
+
+	if(m_sent < m_session.m_inflight_output.size()) {
+		send();
+	} else {
+		m_session.complete_write({}, m_sent);
+	}
+}
+
+// asio reports a cancelled operation as operation_aborted, whatever the errno behind it
+asio::error_code Session::Uring_io::error(const int result) noexcept {
+	return result == -ECANCELED ? asio::error::operation_aborted : asio::error_code(-result, asio::error::get_system_category());
+}
+
+void Session::Uring_io::return_stage(int) noexcept {
+	m_session.complete_stage();
+}
@@ -0,0 +1,91 @@
+#include "slot_map.h"
+
+#include <algorithm>
+
+Slot_map::Slot_map(const std::size_t capacity, const std::size_t local_free_lists)
+    : m_capacity(std::min<std::size_t>(capacity + local_free_list_limit * local_free_lists, no_index)), m_generations(new std::atomic_uint32_t[m_capacity]),
+	m_next_shared(new std::atomic_uint32_t[m_capacity]), m_shared_head(no_index), m_local_free_lists(local_free_lists) {
+
+	for(std::size_t i = 0; i < m_capacity; i++) {
+		m_generations[i] = 0;
+		m_next_shared[i] = no_index;
+	}
+
+	for(auto & free_list : m_local_free_lists) {
+		free_list.reserve(local_free_list_limit + 1);
+	}
+}
+
+std::optional<std::uint64_t> Slot_map::acquire(const std::size_t free_list) noexcept {
+	std::optional<std::uint32_t> index;
+
+	if(free_list < m_local_free_lists.size() && !m_local_free_lists[free_list].empty()) {
+		index = m_local_free_lists[free_list].back();
+		m_local_free_lists[free_list].pop_back();
+	} else if(m_untouched.load(std::memory_order_relaxed) < m_capacity) {
+		if(const auto untouched = m_untouched.fetch_add(1, std::memory_order_relaxed); untouched < m_capacity) {
+			index = static_cast<std::uint32_t>(untouched);
+		}
+	}
+
+	if(!index) {
+		index = pop_shared();
+	}
+
+	if(!index) {
+		return std::nullopt;
+	}
+
+	const auto generation = m_generations[*index].fetch_add(1, std::memory_order_acq_rel) + 1;
+	return static_cast<std::uint64_t>(generation) << 32 | *index;
+}
+
+void Slot_map::release(const std::uint64_t id, const std::size_t free_list) noexcept {
+	const auto index = index_of(id);
+	auto expected = generation_of(id);
+
+	// a stale or foreign id leaves the slot alone
+	if(index >= m_capacity || !m_generations[index].compare_exchange_strong(expected, expected + 1, std::memory_order_acq_rel)) {
+		return;
+	}
+
+	if(free_list < m_local_free_lists.size() && m_local_free_lists[free_list].size() < local_free_list_limit) {
+		m_local_free_lists[free_list].push_back(index);
+	} else {
+		push_shared(index);
+	}
+}
+
+bool Slot_map::contains(const std::uint64_t id) const noexcept {
+	const auto index = index_of(id);
+	const auto generation = generation_of(id);
+	return index < m_capacity && generation % 2 && m_generations[index].load(std::memory_order_acquire) == generation;
+}
+
+std::optional<std::uint32_t> Slot_map::pop_shared() noexcept {
+	auto head = m_shared_head.load(std::memory_order_acquire);
+
+	for(;;) {
+		const auto index = static_cast<std::uint32_t>(head);
+
+		if(index == no_index) {
+			return std::nullopt;
+		}
+
+		// may read the link of a slot another thread popped meanwhile. the tag makes the exchange below fail then
+		const auto next = m_next_shared[index].load(std::memory_order_relaxed);
+		const auto tag = (head >> 32) + 1;
+
+		if(m_shared_head.compare_exchange_weak(head, tag << 32 | next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+			return index;
+		}
+	}
+}
+
+void Slot_map::push_shared(const std::uint32_t index) noexcept {
+	auto head = m_shared_head.load(std::memory_order_relaxed);
+
+	do {
+		m_next_shared[index].store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+	} while(!m_shared_head.compare_exchange_weak(head, (head >> 32 << 32) | index, std::memory_order_release, std::memory_order_relaxed));
+}
@@ -0,0 +1,156 @@
+#include "splice_session.h"
+#include "tcp_server.h"
+
+#include <asio/post.hpp>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+
+Splice_session::Splice_session(tcp_socket && socket, Tcp_server & server, const std::uint64_t client_id)
+    : m_socket(std::move(socket)), m_server(server), m_client_id(client_id) {
+}
+
+Splice_session::~Splice_session() {
+	for(const auto pipe_end : m_pipe) {
+		if(pipe_end != -1) {
+			::close(pipe_end);
+		}
+	}
+}
+
+void Splice_session::start() noexcept {
+	Tcp_flush::configure(m_socket.native_handle(), m_server.m_options.flush_policy);
+
+	asio::error_code error_code;
+	// splice must never block on the socket side. readiness comes from the reactor instead
+	m_socket.non_blocking(true, error_code);
+
+	if(error_code) {
+		m_server.m_logger.error_log("could not set up splicing for client [", m_client_id, ']', error_code.message());
+		shutdown_socket();
+		return;
+	}
+
+	if(!open_pipe()) {
+		m_server.m_logger.error_log("could not open a pipe for client [", m_client_id, ']', std::strerror(errno));
+		shutdown_socket();
+		return;
+	}
+
+	m_server.m_logger.server_log("plaintext client [", m_client_id, "] connected. splicing", m_pipe_capacity, "bytes at a time");
+	asio::post(m_socket.get_executor(), bind_handler_memory([self = shared_from_this()] { self->pump(); }));
+}
+
+bool Splice_session::open_pipe() noexcept {
+
+	if(::pipe2(m_pipe.data(), O_NONBLOCK | O_CLOEXEC)) {
+		return false;
+	}
+
+	// the pipe is the whole output backlog of the session. sizing it to the high watermark gives backpressure for free
+	const auto requested_size = static_cast<int>(m_server.m_options.output_high_watermark);
+	auto pipe_size = ::fcntl(m_pipe[1], F_SETPIPE_SZ, requested_size);
+
+	if(pipe_size == -1) {
+		pipe_size = ::fcntl(m_pipe[1], F_GETPIPE_SZ);
+	}
+
+	m_pipe_capacity = static_cast<std::size_t>(std::max(pipe_size, 0));
+	return m_pipe_capacity;
+}
+
+void Splice_session::shutdown_socket() noexcept {
+
+	if(m_closed) {
+		return;
+	}
+
+	m_closed = true;
+
+	const auto sent = Tcp_flush::segment_counts(m_socket.native_handle());
+	m_server.on_segments_sent(sent);
+	m_server.m_logger.server_log("client [", m_client_id, "] was sent", sent.bytes, "bytes in", sent.data_segments, "data segments");
+
+	asio::error_code error_code;
+	m_socket.shutdown(tcp_socket::shutdown_both, error_code);
+	m_socket.close(error_code);
+	m_server.m_logger.server_log("connection closed with client [", m_client_id, ']');
+	m_server.on_session_closed(m_client_id);
+}
+
+void Splice_session::pump() noexcept {
+	const auto socket_fd = m_socket.native_handle();
+	std::size_t writes = 0;
+	bool corked = false;
+
+	for(bool moved = true; moved && !m_closed;) {
+		moved = false;
+
+		if(!m_read_finished && m_pipe_bytes < m_pipe_capacity) {
+			const auto spliced = ::splice(socket_fd, nullptr, m_pipe[1], nullptr, m_pipe_capacity - m_pipe_bytes,
+							  SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+			if(spliced > 0) {
+				m_pipe_bytes += static_cast<std::size_t>(spliced);
+				moved = true;
+			} else if(!spliced) {
+				// the client half-closed. whatever is still in the pipe gets echoed before closing
+				m_read_finished = true;
+			} else if(errno != EAGAIN) {
+				m_server.m_logger.error_log("splice from client [", m_client_id, "] failed :", std::strerror(errno));
+				shutdown_socket();
+				return;
+			}
+		}
+
+		if(m_pipe_bytes) {
+
+			if(!corked && Tcp_flush::should_cork_turn(m_server.m_options.flush_policy, writes)) {
+				Tcp_flush::cork(socket_fd, true);
+				corked = true;
+			}
+
+			++writes;
+			const auto spliced = ::splice(m_pipe[0], nullptr, socket_fd, nullptr, m_pipe_bytes, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+			if(spliced > 0) {
+				m_pipe_bytes -= static_cast<std::size_t>(spliced);
+				moved = true;
+			} else if(errno != EAGAIN) {
+				m_server.m_logger.error_log("splice to client [", m_client_id, "] failed :", std::strerror(errno));
+				shutdown_socket();
+				return;
+			}
+		}
+	}
+
+	if(m_closed) {
+		return;
+	}
+
+	// the end of the turn. everything it wrote leaves now, partial segment included
+	if(corked) {
+		Tcp_flush::cork(socket_fd, false);
+	}
+
+	auto on_ready = [self = shared_from_this()](const auto & error_code) {
+		if(!error_code) {
+			self->pump();
+		} else {
+			self->m_server.m_logger.error_log(error_code, error_code.message());
+			self->shutdown_socket();
+		}
+	};
+
+	// a pipe holding bytes is only waited on from the socket's write side. splicing into a pipe can also fail for lack of
+	// free pipe slots while the socket stays readable, and waiting for readability then would spin
+	if(m_pipe_bytes) {
+		m_socket.async_wait(tcp_socket::wait_write, bind_handler_memory(on_ready));
+	} else if(!m_read_finished) {
+		m_socket.async_wait(tcp_socket::wait_read, bind_handler_memory(on_ready));
+	} else {
+		shutdown_socket();
+	}
+}
\ No newline at end of file
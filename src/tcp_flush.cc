@@ -0,0 +1,56 @@
+#include "tcp_flush.h"
+
+// linux/tcp.h rather than netinet/tcp.h. the libc copy of tcp_info stops short of the segment counters
+#include <linux/tcp.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+void Tcp_flush::configure(const int socket_fd, const Flush_policy policy) noexcept {
+	// throughput keeps nagle on. a corked burst is pushed out on uncork either way
+	const int no_delay = policy != Flush_policy::throughput;
+	::setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+}
+
+bool Tcp_flush::should_cork(const Flush_policy policy, const std::size_t burst_size) noexcept {
+
+	switch(policy) {
+		case Flush_policy::latency:
+			return false;
+		case Flush_policy::throughput:
+			return true;
+		case Flush_policy::adaptive:
+			return burst_size > adaptive_cork_threshold;
+	}
+
+	return false;
+}
+
+bool Tcp_flush::should_cork_turn(const Flush_policy policy, const std::size_t writes_so_far) noexcept {
+
+	switch(policy) {
+		case Flush_policy::latency:
+			return false;
+		case Flush_policy::throughput:
+			return true;
+		case Flush_policy::adaptive:
+			return writes_so_far > 0;
+	}
+
+	return false;
+}
+
+void Tcp_flush::cork(const int socket_fd, const bool corked) noexcept {
+	const int cork = corked;
+	::setsockopt(socket_fd, IPPROTO_TCP, TCP_CORK, &cork, sizeof(cork));
+}
+
+Tcp_flush::Segment_counts Tcp_flush::segment_counts(const int socket_fd) noexcept {
+	tcp_info info{};
+	socklen_t info_size = sizeof(info);
+
+	if(::getsockopt(socket_fd, IPPROTO_TCP, TCP_INFO, &info, &info_size)) {
+		return {};
+	}
+
+	return {info.tcpi_segs_out, info.tcpi_data_segs_out, info.tcpi_bytes_sent};
+}
@@ -1,11 +1,14 @@
 #include "tcp_server.h"
+#include "listener.h"
 
 #include <asio/steady_timer.hpp>
 #include <asio/dispatch.hpp>
 #include <asio/error.hpp>
-#include <asio/read.hpp>
+#include <asio/strand.hpp>
 #include <algorithm>
-#include <future>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
 
 void Tcp_server::start() noexcept {
 
@@ -15,21 +18,65 @@ void Tcp_server::start() noexcept {
 
 	m_server_running = true;
 
-	auto worker_thread = [&m_io_context = m_io_context, &m_server_running = m_server_running] {
-		while(m_server_running) {
-			m_io_context.run();
-		}
-	};
+	for(std::size_t i = 0; i < m_thread_count; i++) {
+		auto & io_context = m_shards[i % m_shards.size()]->io_context;
+		const auto & worker_cpus = m_options.worker_cpus;
+		const auto cpu = worker_cpus.empty() ? -1 : worker_cpus[i % worker_cpus.size()];
+
+		asio::post(m_thread_pool, [this, &io_context, cpu, i] {
+			worker_index = i;
+
+			if(cpu != -1) {
+				place_worker(cpu);
+			}
+
+			run_worker(io_context);
+		});
+	}
+
+	m_logger.server_log("started with", m_target_workers.load(), "of", m_thread_count, "threads running on", m_shards.size(),
+				  "io_context shards");
+
+	if(m_options.transport == Transport::tls) {
+		configure_ssl_context();
+	}
+
+	if(m_options.lifecycle == Lifecycle::coroutine) {
+#if defined(ASIO_HAS_CO_AWAIT)
+		const auto uring = m_options.io_backend == Io_backend::io_uring && m_options.transport == Transport::plaintext;
 
-	for(std::uint8_t i = 0; i < m_thread_count; i++) {
-		asio::post(m_thread_pool, worker_thread);
+		if(uring || m_options.kernel_tls || m_options.compact_tls || m_options.zerocopy_threshold || m_options.message_stage) {
+			m_logger.error_log("coroutines cover neither io_uring, kernel tls, compact tls, zerocopy nor message stages. every connection runs on callbacks");
+			m_options.lifecycle = Lifecycle::callbacks;
+		}
+#else
+		m_logger.error_log("built without coroutine support. every connection runs on callbacks");
+		m_options.lifecycle = Lifecycle::callbacks;
+#endif
 	}
 
-	m_logger.server_log("started with", static_cast<std::uint16_t>(m_thread_count), "threads");
+	for(auto & shard : m_shards) {
+
+		if(m_options.io_backend == Io_backend::io_uring) {
+			open_uring(*shard);
+		}
+
+		configure_acceptor(*shard);
 
-	configure_ssl_context();
-	configure_acceptor();
-	asio::post(m_io_context, [this] { listen(); });
+		if(shard->uring) {
+			shard->listener = std::make_unique<Uring_listener>(*this, *shard);
+		} else {
+			shard->listener = std::make_unique<Reactor_listener>(*this, *shard);
+		}
+
+		shard->listener->listen();
+	}
+
+	if(m_options.dynamic_threads) {
+		// the quota may have been hit long before the server started
+		m_throttled_time = Cpu_budget::throttled_time();
+		monitor_workers(*m_shards.front());
+	}
 }
 
 void Tcp_server::shutdown() noexcept {
@@ -40,214 +87,346 @@ void Tcp_server::shutdown() noexcept {
 
 	m_logger.server_log("shutting down");
 	m_server_running = false;
-	m_executor_guard.reset();
-	m_acceptor.cancel();
-	m_acceptor.close();
-	m_io_context.stop();
+
+	{
+		// a parked worker has to see the flag once it wakes
+		std::lock_guard worker_guard(m_worker_mutex);
+	}
+
+	m_worker_wakeup.notify_all();
+
+	for(auto & shard : m_shards) {
+		asio::error_code error_code;
+		shard->executor_guard.reset();
+		shard->acceptor.cancel(error_code);
+		shard->acceptor.close(error_code);
+		shard->io_context.stop();
+	}
+
 	m_thread_pool.join();
+
+	if(m_compute_pool) {
+		// stages still queued run to completion. the results they post back land on stopped io_contexts and are dropped
+		m_compute_pool->join();
+	}
+
+	for(auto & shard : m_shards) {
+		if(shard->uring) {
+			shard->uring->shutdown();
+		}
+	}
+
+	m_logger.server_log("buffer pool hits :", Buffer_pool::hits(), "misses :", Buffer_pool::misses());
+	m_logger.server_log("sent", m_bytes_sent.load(), "bytes in", m_data_segments_sent.load(), "data segments,", m_segments_sent.load(),
+				  "segments in total");
 	m_logger.server_log("shutdown");
 }
 
-void Tcp_server::connection_timeout() noexcept {
-	m_acceptor.cancel();
-	m_logger.server_log("deaf state");
+Tcp_server::Shard::Shard(const int concurrency_hint, const int cpu, const Token_bucket accept_bucket)
+    : io_context(concurrency_hint), cpu(cpu), accept_bucket(accept_bucket) {
+}
 
-	auto timeout_timer = std::make_shared<asio::steady_timer>(m_io_context);
+Tcp_server::Shard::~Shard() = default;
 
-	timeout_timer->expires_from_now(std::chrono::seconds(timeout_seconds));
+void Tcp_server::on_session_closed(const std::uint64_t client_id) noexcept {
+	assert(m_client_ids.contains(client_id));
+	m_client_ids.release(client_id, worker_index);
+	--m_admitted_connections;
+}
 
-	timeout_timer->async_wait([this, timeout_timer](const auto & error_code) {
-		if(!error_code) {
-			m_logger.server_log("connection timeout over. shifting to listening state");
-			asio::post(m_io_context, [this] { listen(); });
-		} else {
-			m_logger.error_log(error_code, error_code.message());
-		}
-	});
+void Tcp_server::on_segments_sent(const Tcp_flush::Segment_counts & sent) noexcept {
+	m_segments_sent.fetch_add(sent.segments, std::memory_order_relaxed);
+	m_data_segments_sent.fetch_add(sent.data_segments, std::memory_order_relaxed);
+	m_bytes_sent.fetch_add(sent.bytes, std::memory_order_relaxed);
 }
 
-void Tcp_server::shutdown_socket(std::shared_ptr<ssl_tcp_socket> ssl_socket, const std::uint64_t client_id) noexcept {
-	{
-		std::lock_guard client_id_guard(m_client_id_mutex);
-		assert(m_active_client_ids.count(client_id));
-		m_active_client_ids.erase(client_id);
+std::string_view Tcp_server::admission_refusal(Shard & shard) noexcept {
+
+	// reserved before the handshake, so connections still in theirs count against the limit too
+	if(m_admitted_connections.fetch_add(1) >= m_options.max_connections) {
+		--m_admitted_connections;
+		return "server at capacity. try again later\n";
 	}
 
-	try {
-		ssl_socket->lowest_layer().shutdown(tcp_socket::shutdown_both);
-		ssl_socket->lowest_layer().close();
-		m_logger.server_log("connection closed with client [", client_id, ']');
-	} catch(const std::system_error & error) {
-		m_logger.error_log(error.what());
+	if(!shard.accept_bucket.try_take()) {
+		--m_admitted_connections;
+		return "too many new connections. try again later\n";
+	}
+
+	return {};
+}
+
+void Tcp_server::turn_away(const int socket_fd, const std::string_view reason) noexcept {
+	m_logger.error_log("turning a connection away :", reason.substr(0, reason.size() - 1));
+
+	// a tls client expects a handshake and would take plaintext for a protocol error. it only sees the close
+	if(m_options.transport == Transport::plaintext) {
+		// the send buffer of a fresh connection is empty, so the reason goes out whole without blocking
+		::send(socket_fd, reason.data(), reason.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
 	}
 
-	--m_active_connections;
+	::close(socket_fd);
 }
 
-void Tcp_server::listen() noexcept {
-	m_acceptor.listen();
-	m_logger.server_log("listening state");
+void Tcp_server::create_session(Shard & shard, tcp_socket && socket, const int uring_fd) noexcept {
+	Uring_backend * const uring = uring_fd != -1 ? shard.uring.get() : nullptr;
+	auto refusal = admission_refusal(shard);
+	const auto acquired_id = refusal.empty() ? m_client_ids.acquire(worker_index) : std::nullopt;
 
-	if(m_active_connections > max_connections) {
-		m_logger.error_log("max connections reached. taking a connection timeout for", timeout_seconds, "seconds");
-		asio::post(m_io_context, [this] { connection_timeout(); });
+	if(!acquired_id && refusal.empty()) {
+		--m_admitted_connections;
+		refusal = "server at capacity. try again later\n";
+	}
+
+	if(!refusal.empty()) {
+		asio::error_code error_code;
+		turn_away(uring ? uring_fd : socket.release(error_code), refusal);
 		return;
 	}
 
-	using id_task_type = std::packaged_task<std::uint64_t()>;
+	const auto client_id = *acquired_id;
 
-	auto client_id_task = std::make_shared<id_task_type>([this] { return get_random_spare_id(); });
-	asio::post(m_io_context, [client_id_task] { return (*client_id_task)(); });
+#if defined(ASIO_HAS_CO_AWAIT)
+	if(m_options.lifecycle == Lifecycle::coroutine && !uring) {
+		const auto plaintext = m_options.transport == Transport::plaintext;
+		m_logger.server_log("new", plaintext ? "plaintext client [" : "client [", client_id, "] on a coroutine");
+		Coroutine_session::spawn(std::move(socket), plaintext ? nullptr : &m_ssl_context, *this, client_id);
+		return;
+	}
+#endif
+
+	if(uring) {
+		m_logger.server_log("new plaintext client [", client_id, "] on io_uring");
+		std::make_shared<Session>(std::move(socket), *uring, uring_fd, *this, client_id)->start();
+	} else if(m_options.transport == Transport::plaintext && m_options.echo_mode == Echo_mode::streaming && !m_options.message_stage) {
+		std::make_shared<Splice_session>(std::move(socket), *this, client_id)->start();
+	} else if(m_options.transport == Transport::plaintext) {
+		m_logger.server_log("new plaintext client [", client_id, ']');
+		std::make_shared<Session>(std::move(socket), *this, client_id)->start();
+	} else {
+		m_logger.server_log("new client [", client_id, "] attempting to connect. handshake pending");
+		std::make_shared<Session>(std::move(socket), m_ssl_context, *this, client_id)->start();
+	}
+}
 
-	auto ssl_socket = std::make_shared<ssl_tcp_socket>(m_io_context, m_ssl_context);
+void Tcp_server::open_uring(Shard & shard) noexcept {
 
-	auto on_connection_attempt = [this, ssl_socket, client_id_task](const auto & error_code) {
-		if(!error_code) {
-			auto new_client_id = client_id_task->get_future().get();
+	if(m_options.transport != Transport::plaintext) {
+		m_logger.server_log("io_uring backend only carries plaintext sessions. tls stays on epoll");
+		return;
+	}
 
-			{
-				std::lock_guard client_id_guard(m_client_id_mutex);
-				m_active_client_ids.insert(new_client_id);
-			}
+	shard.uring = std::make_unique<Uring_backend>();
 
-			m_logger.server_log("new client [", new_client_id, "] attempting to connect. handshake pending");
-			asio::post(m_io_context, [this, ssl_socket, new_client_id] { attempt_handshake(ssl_socket, new_client_id); });
-			asio::post(m_io_context, [this] { listen(); });
-		} else {
-			m_logger.error_log(error_code, error_code.message());
-			// socket could not connect - no shutdown required
-		}
-	};
+	if(!shard.uring->open()) {
+		m_logger.error_log("io_uring unavailable :", std::strerror(errno), ". falling back to epoll");
+		shard.uring.reset();
+		return;
+	}
+
+	shard.uring->start();
 
-	m_acceptor.async_accept(ssl_socket->lowest_layer(), on_connection_attempt);
+	if(m_options.threading == Threading::shared && m_thread_count > 1) {
+		m_logger.error_log("io_uring sessions run on their shard's ring thread. with shared threading", m_thread_count - 1, "of",
+					 m_thread_count, "workers stay idle. sharded threading gives every worker a ring");
+	}
 }
 
-void Tcp_server::process_message(const Network_message & message, const asio::error_code & connection_code) noexcept {
+void Tcp_server::configure_ssl_context() noexcept {
+	m_ssl_context.set_options(asio::ssl::context::default_workarounds | asio::ssl::context::verify_peer);
 
-	auto on_write = [this, ssl_socket = message.ssl_socket, client_id = message.client_id](const auto & error_code,
-															   const auto bytes_sent) {
-		if(!error_code) {
-			m_logger.server_log(bytes_sent, "bytes sent to client [", client_id, ']');
+	// an idle connection gives its record buffers back instead of holding two full records for as long as it stays open
+	if(m_options.compact_tls) {
+		SSL_CTX_set_mode(m_ssl_context.native_handle(), SSL_MODE_RELEASE_BUFFERS);
+	}
 
-			{
-				std::shared_lock received_messages_guard(m_received_messages_mutex);
+#ifdef SSL_OP_ENABLE_KTLS
+	if(m_options.kernel_tls) {
+		SSL_CTX_set_options(m_ssl_context.native_handle(), SSL_OP_ENABLE_KTLS);
+	}
+#else
+	if(m_options.kernel_tls) {
+		m_logger.server_log("openssl was built without kernel tls. tls stays in user space");
+	}
+#endif
 
-				const auto & all_client_messages = m_received_messages[client_id];
-				assert(m_received_messages.count(client_id));
+	try {
+		m_ssl_context.use_certificate_file(std::string(m_auth_dir) + "certificate.pem", asio::ssl::context_base::pem);
+		m_ssl_context.use_rsa_private_key_file(std::string(m_auth_dir) + "private_key.pem", asio::ssl::context_base::pem);
+	} catch(const std::exception & exception) {
+		m_logger.error_log(exception.what(), ". Try after running generate_scripts.sh");
+		shutdown();
+	}
+}
 
-				received_messages_guard.unlock();
+void Tcp_server::configure_acceptor(Shard & shard) noexcept {
+	// every shard binds the same port. the kernel then hashes each new connection onto one of their accept queues
+	using reuse_port = asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
 
-				m_logger.send_log(client_id, all_client_messages);
-			}
-		} else {
-			m_logger.error_log(error_code, error_code.message());
-		}
+	asio::ip::tcp::endpoint endpoint(asio::ip::address_v4::any(), m_listen_port);
+	shard.acceptor.open(endpoint.protocol());
+	shard.acceptor.set_option(asio::ip::tcp::socket::reuse_address(true));
 
-		asio::post(m_io_context, [this, ssl_socket, client_id] { shutdown_socket(ssl_socket, client_id); });
-	};
+	if(m_shards.size() > 1) {
+		shard.acceptor.set_option(reuse_port(true));
+	}
 
-	m_logger.server_log("processing message from client [", message.client_id, ']');
-	m_logger.receive_log(message.client_id, *message.content);
+	if(m_options.socket_busy_poll.count()) {
+		// accepted sockets inherit both from the listener, so the accept path stays untouched
+		using busy_poll = asio::detail::socket_option::integer<SOL_SOCKET, SO_BUSY_POLL>;
+		using prefer_busy_poll = asio::detail::socket_option::boolean<SOL_SOCKET, SO_PREFER_BUSY_POLL>;
 
-	{
-		std::lock_guard received_messages_Guard(m_received_messages_mutex);
+		asio::error_code error_code;
+		shard.acceptor.set_option(busy_poll(static_cast<int>(m_options.socket_busy_poll.count())), error_code);
 
-		if(m_received_messages.count(message.client_id)) {
-			m_received_messages[message.client_id] += *message.content;
+		if(error_code) {
+			m_logger.error_log("socket busy polling refused :", error_code.message());
 		} else {
-			m_received_messages[message.client_id] = std::move(*message.content);
+			// keeps the device interrupts deferred while the application polls
+			shard.acceptor.set_option(prefer_busy_poll(true), error_code);
 		}
 	}
 
-	if(connection_code) {
-		std::shared_lock messages_guard(m_received_messages_mutex);
-		asio::async_write(*message.ssl_socket, asio::buffer(m_received_messages[message.client_id]), on_write);
-	} else {
-		asio::post(m_io_context,
-			     [this, ssl_socket = message.ssl_socket, client_id = message.client_id] { read_message(ssl_socket, client_id); });
+	if(m_options.steer_incoming_cpu && shard.cpu != -1) {
+		// the reuseport group prefers a listener whose incoming cpu matches the core handling the syn
+		using incoming_cpu = asio::detail::socket_option::integer<SOL_SOCKET, SO_INCOMING_CPU>;
+		shard.acceptor.set_option(incoming_cpu(shard.cpu));
+	} else if(m_options.steer_incoming_cpu) {
+		m_logger.error_log("incoming cpu steering needs sharded threading and pinned workers. ignored");
 	}
+
+	shard.acceptor.bind(endpoint);
+	m_logger.server_log("acceptor bound to port number", m_listen_port);
 }
 
-void Tcp_server::read_message(std::shared_ptr<ssl_tcp_socket> ssl_socket, const std::uint64_t client_id) noexcept {
+void Tcp_server::run_worker(asio::io_context & io_context) noexcept {
 
-	auto on_read = [this, ssl_socket, client_id](auto read_buffer, const auto & error_code, const auto bytes_read) {
-		const auto received_valid_message = [&error_code, bytes_read] {
-			return bytes_read && (!error_code || error_code == asio::error::eof || error_code == asio::error::no_permission);
-		};
+	if(m_options.dynamic_threads) {
+		std::lock_guard worker_guard(m_worker_mutex);
+		m_worker_thread_ids.push_back(Cpu_budget::current_thread_id());
+		m_running_workers++;
+	}
 
-		if(received_valid_message()) {
-			asio::post(m_io_context, [this, ssl_socket, read_buffer, client_id, error_code] {
-				process_message({ssl_socket, read_buffer, client_id}, error_code);
-			});
-		} else {
-			m_logger.error_log(error_code, error_code.message());
-			asio::post(m_io_context, [this, ssl_socket, client_id] { shutdown_socket(ssl_socket, client_id); });
-		}
-	};
+	auto idle_since = std::chrono::steady_clock::now();
 
-	auto on_read_wait_over = [this, ssl_socket, client_id, on_read](const auto & error_code) {
-		if(!error_code) {
-			m_logger.server_log("message received from client [", client_id, ']');
+	// the work guard keeps run() and run_one() from returning until shutdown stops the io_context
+	while(!io_context.stopped()) {
 
-			auto read_buffer = std::make_shared<std::string>(ssl_socket->lowest_layer().available(), '\0');
+		if(m_options.dynamic_threads) {
+			park_surplus_worker();
+		}
 
-			asio::async_read(*ssl_socket, asio::buffer(*read_buffer), [on_read, read_buffer](auto && error_code, auto bytes_read) {
-				on_read(read_buffer, std::forward<decltype(error_code)>(error_code), bytes_read);
-			});
-		} else {
-			m_logger.error_log(error_code, error_code.message());
-			asio::post(m_io_context, [this, ssl_socket, client_id] { shutdown_socket(ssl_socket, client_id); });
+		switch(m_options.idle_strategy) {
+			case Idle_strategy::block:
+				// a dynamic worker has to come back between handlers to notice that it has become surplus
+				if(m_options.dynamic_threads) {
+					io_context.run_one();
+				} else {
+					io_context.run();
+				}
+
+				break;
+			case Idle_strategy::spin_then_block:
+				if(io_context.poll()) {
+					idle_since = std::chrono::steady_clock::now();
+				} else if(std::chrono::steady_clock::now() - idle_since >= m_options.idle_spin) {
+					io_context.run_one();
+					idle_since = std::chrono::steady_clock::now();
+				}
+
+				break;
+			case Idle_strategy::busy_poll:
+				io_context.poll();
+				break;
 		}
-	};
+	}
+}
+
+void Tcp_server::park_surplus_worker() noexcept {
 
-	ssl_socket->lowest_layer().async_wait(tcp_socket::wait_read, on_read_wait_over);
+	if(m_running_workers.load(std::memory_order_relaxed) <= m_target_workers.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	std::unique_lock worker_guard(m_worker_mutex);
+
+	if(m_running_workers <= m_target_workers) {
+		return;
+	}
+
+	m_running_workers--;
+	m_worker_wakeup.wait(worker_guard, [this] { return !m_server_running || m_running_workers < m_target_workers; });
+	m_running_workers++;
 }
 
-void Tcp_server::attempt_handshake(std::shared_ptr<ssl_tcp_socket> ssl_socket, const std::uint64_t client_id) noexcept {
+void Tcp_server::monitor_workers(Shard & shard) noexcept {
+	auto adjust_timer = std::make_shared<asio::steady_timer>(shard.io_context, worker_adjust_interval);
 
-	auto on_handshake = [this, ssl_socket, client_id](const auto & error_code) {
-		if(!error_code) {
-			m_logger.server_log("handshake successful with client [", client_id, ']');
-			++m_active_connections;
-			asio::post(m_io_context, [this, ssl_socket, client_id] { read_message(ssl_socket, client_id); });
-		} else {
-			m_logger.error_log(error_code, error_code.message());
-			asio::post(m_io_context, [this, ssl_socket, client_id] { shutdown_socket(ssl_socket, client_id); });
+	adjust_timer->async_wait([this, &shard, adjust_timer](const auto & error_code) {
+		if(error_code || !m_server_running) {
+			return;
 		}
-	};
 
-	m_logger.server_log("handshake attempt with client [", client_id, ']');
-	ssl_socket->async_handshake(asio::ssl::stream_base::handshake_type::server, on_handshake);
+		// the probe queues up behind everything already ready to run. its wait is the lag any new event sees
+		asio::post(shard.io_context, [this, &shard, queued_at = std::chrono::steady_clock::now()] {
+			adjust_workers(shard, std::chrono::steady_clock::now() - queued_at);
+			monitor_workers(shard);
+		});
+	});
 }
 
-void Tcp_server::configure_ssl_context() noexcept {
-	m_ssl_context.set_options(asio::ssl::context::default_workarounds | asio::ssl::context::verify_peer);
+void Tcp_server::adjust_workers(Shard & shard, const std::chrono::steady_clock::duration queue_lag) noexcept {
+	std::chrono::nanoseconds run_delay{0};
+	std::unique_lock worker_guard(m_worker_mutex);
 
-	try {
-		m_ssl_context.use_certificate_file(std::string(m_auth_dir) + "certificate.pem", asio::ssl::context_base::pem);
-		m_ssl_context.use_rsa_private_key_file(std::string(m_auth_dir) + "private_key.pem", asio::ssl::context_base::pem);
-	} catch(const std::exception & exception) {
-		m_logger.error_log(exception.what(), ". Try after running generate_scripts.sh");
-		shutdown();
+	for(const auto thread_id : m_worker_thread_ids) {
+		run_delay += Cpu_budget::run_delay(thread_id);
 	}
-}
 
-void Tcp_server::configure_acceptor() noexcept {
-	asio::ip::tcp::endpoint endpoint(asio::ip::address_v4::any(), m_listen_port);
-	m_acceptor.open(endpoint.protocol());
-	m_acceptor.set_option(asio::ip::tcp::socket::reuse_address(true));
-	m_acceptor.bind(endpoint);
-	m_logger.server_log("acceptor bound to port number", m_listen_port);
+	const auto throttled_time = Cpu_budget::throttled_time();
+	// parked workers never wait on the cpu, so the delay is spread over the running ones only
+	const auto cpu_wait = (run_delay - m_worker_run_delay) / std::max<std::size_t>(m_running_workers, 1) + (throttled_time - m_throttled_time);
+	const auto oversubscribed = cpu_wait > worker_adjust_interval / worker_oversubscribed_divisor;
+	const auto target_workers = m_target_workers.load();
+
+	m_worker_run_delay = run_delay;
+	m_throttled_time = throttled_time;
+	m_worker_grow_holdoff = std::max(m_worker_grow_holdoff - 1, 0);
+
+	if(oversubscribed && target_workers > minimum_thread_count) {
+		m_target_workers = target_workers - 1;
+		m_worker_grow_holdoff = worker_grow_holdoff;
+	} else if(!oversubscribed && !m_worker_grow_holdoff && queue_lag > worker_grow_lag && target_workers < m_thread_count) {
+		m_target_workers = target_workers + 1;
+	} else {
+		return;
+	}
+
+	worker_guard.unlock();
+	m_worker_wakeup.notify_all();
+
+	if(m_target_workers < target_workers) {
+		// a worker blocked in the io_context only notices the lower target once it returns from a handler
+		asio::post(shard.io_context, [] {});
+	}
+
+	m_logger.server_log("workers waited",
+				  std::chrono::duration_cast<std::chrono::microseconds>(cpu_wait).count(), "us on the cpu and the queue lagged",
+				  std::chrono::duration_cast<std::chrono::microseconds>(queue_lag).count(), "us. running", m_target_workers.load(),
+				  "of", m_thread_count, "workers");
 }
 
-[[nodiscard]]
-std::uint64_t Tcp_server::get_random_spare_id() const noexcept {
-	std::shared_lock client_id_guard(m_client_id_mutex);
-	std::uint64_t unique_id = 0;
+void Tcp_server::place_worker(const int cpu) noexcept {
 
-	do {
-		unique_id = random_id_range(random_generator);
-	} while(m_active_client_ids.count(unique_id));
+	if(!Thread_placement::pin_current_thread(cpu)) {
+		m_logger.error_log("could not pin a worker to cpu", cpu);
+		return;
+	}
+
+	// before the first buffer is acquired, so the thread's pool never holds remote memory
+	if(!Thread_placement::prefer_local_memory()) {
+		m_logger.error_log("could not bind the memory of the worker on cpu", cpu, "to its node");
+	}
 
-	return unique_id;
+	m_logger.server_log("worker pinned to cpu", cpu, "on numa node", Thread_placement::current_node());
 }
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "thread_placement.h"
+
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sched.h>
+
+bool Thread_placement::pin_current_thread(const int cpu) noexcept {
+
+	if(cpu < 0 || cpu >= CPU_SETSIZE) {
+		return false;
+	}
+
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	CPU_SET(cpu, &cpu_set);
+	return !::pthread_setaffinity_np(::pthread_self(), sizeof(cpu_set), &cpu_set);
+}
+
+bool Thread_placement::prefer_local_memory() noexcept {
+	return !::syscall(SYS_set_mempolicy, MPOL_LOCAL, nullptr, 0);
+}
+
+int Thread_placement::current_node() noexcept {
+	unsigned node = 0;
+	return ::syscall(SYS_getcpu, nullptr, &node, nullptr) ? -1 : static_cast<int>(node);
+}
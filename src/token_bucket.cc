@@ -0,0 +1,26 @@
+#include "token_bucket.h"
+
+#include <algorithm>
+
+Token_bucket::Token_bucket(const double rate, const double burst) noexcept
+    : m_rate(std::max(rate, 0.0)), m_burst(std::max(burst, 1.0)), m_tokens(m_burst) {
+}
+
+bool Token_bucket::try_take() noexcept {
+
+	if(!m_rate) {
+		return true;
+	}
+
+	const auto now = clock_type::now();
+	const std::chrono::duration<double> elapsed = now - m_refilled_at;
+	m_tokens = std::min(m_burst, m_tokens + elapsed.count() * m_rate);
+	m_refilled_at = now;
+
+	if(m_tokens < 1) {
+		return false;
+	}
+
+	--m_tokens;
+	return true;
+}
@@ -0,0 +1,338 @@
+#include "uring_backend.h"
+
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+namespace {
+
+template <typename value_type>
+value_type * ring_field(void * ring, const std::uint32_t offset) noexcept {
+	return reinterpret_cast<value_type *>(static_cast<char *>(ring) + offset);
+}
+
+unsigned load_acquire(const unsigned * value) noexcept {
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+void store_release(unsigned * value, const unsigned new_value) noexcept {
+	__atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+}
+
+} // namespace
+
+Uring_backend::~Uring_backend() {
+
+	if(m_sqes) {
+		::munmap(m_sqes, m_params.sq_entries * sizeof(io_uring_sqe));
+	}
+
+	if(m_cq_ring && m_cq_ring != m_sq_ring) {
+		::munmap(m_cq_ring, m_cq_ring_size);
+	}
+
+	if(m_sq_ring) {
+		::munmap(m_sq_ring, m_sq_ring_size);
+	}
+
+	if(m_ring_fd != -1) {
+		::close(m_ring_fd);
+	}
+}
+
+bool Uring_backend::open() noexcept {
+	m_params.flags = IORING_SETUP_CLAMP;
+
+	const auto ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, ring_entries, &m_params));
+
+	if(ring_fd < 0) {
+		return false;
+	}
+
+	m_ring_fd = ring_fd;
+
+	m_sq_ring_size = m_params.sq_off.array + m_params.sq_entries * sizeof(unsigned);
+	m_cq_ring_size = m_params.cq_off.cqes + m_params.cq_entries * sizeof(io_uring_cqe);
+
+	if(m_params.features & IORING_FEAT_SINGLE_MMAP) {
+		m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+	}
+
+	m_sq_ring = ::mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+
+	if(m_sq_ring == MAP_FAILED) {
+		m_sq_ring = nullptr;
+		return false;
+	}
+
+	if(m_params.features & IORING_FEAT_SINGLE_MMAP) {
+		m_cq_ring = m_sq_ring;
+	} else {
+		m_cq_ring = ::mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+
+		if(m_cq_ring == MAP_FAILED) {
+			m_cq_ring = nullptr;
+			return false;
+		}
+	}
+
+	auto * const sqes = ::mmap(nullptr, m_params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+					   MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+
+	if(sqes == MAP_FAILED) {
+		return false;
+	}
+
+	m_sqes = static_cast<io_uring_sqe *>(sqes);
+
+	// the sq array maps ring positions to sqe slots. it never changes since slots are filled in ring order
+	auto * const sq_array = ring_field<unsigned>(m_sq_ring, m_params.sq_off.array);
+
+	for(unsigned index = 0; index < m_params.sq_entries; index++) {
+		sq_array[index] = index;
+	}
+
+	io_uring_rsrc_register buffer_table{};
+	buffer_table.nr = registered_buffer_slots;
+	buffer_table.flags = IORING_RSRC_REGISTER_SPARSE;
+
+	if(!::syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS2, &buffer_table, sizeof(buffer_table))) {
+		m_free_buffer_slots.reserve(registered_buffer_slots);
+
+		for(int slot = registered_buffer_slots - 1; slot >= 0; slot--) {
+			m_free_buffer_slots.push_back(slot);
+		}
+	}
+
+	return true;
+}
+
+void Uring_backend::start() noexcept {
+	m_ring_thread = std::thread([this] { run(); });
+}
+
+void Uring_backend::shutdown() noexcept {
+
+	if(!m_ring_thread.joinable()) {
+		return;
+	}
+
+	// a no-op completion wakes the ring thread out of its wait so it notices the flag
+	m_stopping = true;
+
+	io_uring_sqe wake_up{};
+	wake_up.opcode = IORING_OP_NOP;
+	submit(wake_up);
+	m_ring_thread.join();
+
+	io_uring_sqe cancel_all{};
+	cancel_all.opcode = IORING_OP_ASYNC_CANCEL;
+	cancel_all.fd = -1;
+	cancel_all.cancel_flags = IORING_ASYNC_CANCEL_ANY;
+	submit(cancel_all);
+
+	// the completions still hold their sessions. a kernel that cannot cancel everything at once gets a quiet second
+	pollfd ring_events{m_ring_fd, POLLIN, 0};
+
+	while(m_in_flight && (completions_ready() || ::poll(&ring_events, 1, shutdown_wait_milliseconds) > 0)) {
+		reap();
+		enter(unsubmitted(), 0, 0);
+	}
+}
+
+void Uring_backend::accept(const int listen_fd, Operation & operation) noexcept {
+	io_uring_sqe sqe{};
+	sqe.opcode = IORING_OP_ACCEPT;
+	sqe.fd = listen_fd;
+	sqe.accept_flags = SOCK_CLOEXEC;
+	sqe.ioprio = m_multishot_accept ? IORING_ACCEPT_MULTISHOT : 0;
+	sqe.user_data = reinterpret_cast<std::uint64_t>(&operation);
+	submit(sqe);
+}
+
+void Uring_backend::receive(const int socket_fd, void * const data, const std::size_t size, const int buffer_index,
+				    Operation & operation) noexcept {
+	io_uring_sqe sqe{};
+	sqe.fd = socket_fd;
+	sqe.addr = reinterpret_cast<std::uint64_t>(data);
+	sqe.len = static_cast<std::uint32_t>(size);
+	sqe.user_data = reinterpret_cast<std::uint64_t>(&operation);
+
+	if(buffer_index != -1) {
+		sqe.opcode = IORING_OP_READ_FIXED;
+		sqe.buf_index = static_cast<std::uint16_t>(buffer_index);
+	} else {
+		sqe.opcode = IORING_OP_RECV;
+	}
+
+	submit(sqe);
+}
+
+void Uring_backend::send(const int socket_fd, const void * const data, const std::size_t size, Operation & operation) noexcept {
+	io_uring_sqe sqe{};
+	sqe.opcode = IORING_OP_SEND;
+	sqe.fd = socket_fd;
+	sqe.addr = reinterpret_cast<std::uint64_t>(data);
+	sqe.len = static_cast<std::uint32_t>(size);
+	sqe.msg_flags = MSG_NOSIGNAL;
+	sqe.user_data = reinterpret_cast<std::uint64_t>(&operation);
+	submit(sqe);
+}
+
+void Uring_backend::post(Operation & operation) noexcept {
+	io_uring_sqe sqe{};
+	sqe.opcode = IORING_OP_NOP;
+	sqe.user_data = reinterpret_cast<std::uint64_t>(&operation);
+	submit(sqe);
+}
+
+int Uring_backend::register_buffer(void * const data, const std::size_t size) noexcept {
+	int buffer_index = -1;
+
+	{
+		std::lock_guard buffer_guard(m_buffer_mutex);
+
+		if(m_free_buffer_slots.empty()) {
+			return -1;
+		}
+
+		buffer_index = m_free_buffer_slots.back();
+		m_free_buffer_slots.pop_back();
+	}
+
+	iovec buffer{data, size};
+	io_uring_rsrc_update2 update{};
+	update.offset = static_cast<std::uint32_t>(buffer_index);
+	update.data = reinterpret_cast<std::uint64_t>(&buffer);
+	update.nr = 1;
+
+	if(::syscall(__NR_io_uring_register, m_ring_fd, IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update)) != 1) {
+		std::lock_guard buffer_guard(m_buffer_mutex);
+		m_free_buffer_slots.push_back(buffer_index);
+		return -1;
+	}
+
+	return buffer_index;
+}
+
+void Uring_backend::unregister_buffer(const int buffer_index) noexcept {
+
+	if(buffer_index == -1) {
+		return;
+	}
+
+	// a read still in flight keeps its own reference to the registered pages. clearing the slot does not pull them away
+	iovec empty_buffer{nullptr, 0};
+	io_uring_rsrc_update2 update{};
+	update.offset = static_cast<std::uint32_t>(buffer_index);
+	update.data = reinterpret_cast<std::uint64_t>(&empty_buffer);
+	update.nr = 1;
+	::syscall(__NR_io_uring_register, m_ring_fd, IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update));
+
+	std::lock_guard buffer_guard(m_buffer_mutex);
+	m_free_buffer_slots.push_back(buffer_index);
+}
+
+bool Uring_backend::multishot_accept() const noexcept {
+	return m_multishot_accept;
+}
+
+void Uring_backend::disable_multishot_accept() noexcept {
+	m_multishot_accept = false;
+}
+
+void Uring_backend::queue(const io_uring_sqe & sqe) noexcept {
+	const auto * const sq_head = ring_field<unsigned>(m_sq_ring, m_params.sq_off.head);
+	auto * const sq_tail = ring_field<unsigned>(m_sq_ring, m_params.sq_off.tail);
+	const auto tail = *sq_tail;
+
+	if(tail - load_acquire(sq_head) == m_params.sq_entries) {
+		enter(m_params.sq_entries, 0, 0);
+	}
+
+	m_sqes[tail & *ring_field<unsigned>(m_sq_ring, m_params.sq_off.ring_mask)] = sqe;
+	store_release(sq_tail, tail + 1);
+}
+
+void Uring_backend::submit(const io_uring_sqe & sqe) noexcept {
+	++m_in_flight;
+
+	std::lock_guard submission_guard(m_submission_mutex);
+	queue(sqe);
+
+	// the ring thread hands its submissions over together with its next wait. every other thread submits right away
+	if(std::this_thread::get_id() != m_ring_thread.get_id()) {
+		enter(unsubmitted(), 0, 0);
+	}
+}
+
+int Uring_backend::enter(const unsigned to_submit, const unsigned min_complete, const unsigned flags) noexcept {
+	return static_cast<int>(::syscall(__NR_io_uring_enter, m_ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+unsigned Uring_backend::unsubmitted() const noexcept {
+	// the kernel consumes the queue only inside io_uring_enter. whatever lies between head and tail is still ours
+	return load_acquire(ring_field<unsigned>(m_sq_ring, m_params.sq_off.tail)) -
+	       load_acquire(ring_field<unsigned>(m_sq_ring, m_params.sq_off.head));
+}
+
+bool Uring_backend::completions_ready() const noexcept {
+	const auto * const cq_head = ring_field<unsigned>(m_cq_ring, m_params.cq_off.head);
+	const auto * const cq_tail = ring_field<unsigned>(m_cq_ring, m_params.cq_off.tail);
+	const auto * const sq_flags = ring_field<unsigned>(m_sq_ring, m_params.sq_off.flags);
+
+	return *cq_head != load_acquire(cq_tail) || (load_acquire(sq_flags) & IORING_SQ_CQ_OVERFLOW);
+}
+
+void Uring_backend::reap() noexcept {
+	auto * const cq_head = ring_field<unsigned>(m_cq_ring, m_params.cq_off.head);
+	const auto * const cq_tail = ring_field<unsigned>(m_cq_ring, m_params.cq_off.tail);
+	const auto cq_mask = *ring_field<unsigned>(m_cq_ring, m_params.cq_off.ring_mask);
+	const auto * const cqes = ring_field<io_uring_cqe>(m_cq_ring, m_params.cq_off.cqes);
+	const auto * const sq_flags = ring_field<unsigned>(m_sq_ring, m_params.sq_off.flags);
+
+	for(;;) {
+		const auto head = *cq_head;
+
+		if(head == load_acquire(cq_tail)) {
+			// completions the cq had no room for are parked in the kernel until it is asked for them
+			if(!(load_acquire(sq_flags) & IORING_SQ_CQ_OVERFLOW)) {
+				break;
+			}
+
+			enter(0, 0, IORING_ENTER_GETEVENTS);
+			continue;
+		}
+
+		const auto cqe = cqes[head & cq_mask];
+		store_release(cq_head, head + 1);
+
+		const bool more = cqe.flags & IORING_CQE_F_MORE;
+
+		if(!more) {
+			--m_in_flight;
+		}
+
+		if(cqe.user_data) {
+			reinterpret_cast<Operation *>(cqe.user_data)->complete(cqe.res, more);
+		}
+	}
+}
+
+void Uring_backend::run() noexcept {
+
+	while(!m_stopping) {
+		// sqes are published fully written, so the enter needs no submission mutex. a stale count only overshoots
+		if(enter(unsubmitted(), 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EBUSY) {
+			break;
+		}
+
+		reap();
+	}
+}
@@ -0,0 +1,45 @@
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic_uint64_t operator_new_calls{0};
+
+} // namespace
+
+std::uint64_t Allocation_counter::operator_new_calls() noexcept {
+	return ::operator_new_calls.load(std::memory_order_relaxed);
+}
+
+void * operator new(const std::size_t size) {
+	::operator_new_calls.fetch_add(1, std::memory_order_relaxed);
+
+	if(auto * const pointer = std::malloc(size ? size : 1)) {
+		return pointer;
+	}
+
+	throw std::bad_alloc();
+}
+
+void * operator new[](const std::size_t size) {
+	return ::operator new(size);
+}
+
+void operator delete(void * const pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void * const pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void * const pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void * const pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
@@ -0,0 +1,12 @@
+#ifndef ALLOCATION_COUNTER_HXX
+#define ALLOCATION_COUNTER_HXX
+
+#include <cstdint>
+
+// counts the calls into the global operator new of the whole process. linking allocation_counter.cc replaces it
+class Allocation_counter {
+public:
+	static std::uint64_t operator_new_calls() noexcept;
+};
+
+#endif // ALLOCATION_COUNTER_HXX
@@ -0,0 +1,372 @@
+#include "echo_client.h"
+
+#include <openssl/ssl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr auto connect_attempts = 500;
+constexpr auto connect_retry_interval = std::chrono::milliseconds(10);
+// held connections come from 127.0.0.1 up to 127.0.0.64. a single source address runs out of ephemeral ports near 28000
+constexpr in_addr_t source_addresses = 64;
+
+// what the parent asks of the child. a count of 0 stops it
+struct Command {
+	bool hold = false; // connections to open and keep rather than messages to echo
+	std::uint64_t count = 0;
+};
+
+bool read_exactly(const int fd, void * const data, const std::size_t size) noexcept {
+	std::size_t done = 0;
+
+	while(done < size) {
+		const auto result = ::read(fd, static_cast<char *>(data) + done, size - done);
+
+		if(result <= 0) {
+			return false;
+		}
+
+		done += static_cast<std::size_t>(result);
+	}
+
+	return true;
+}
+
+bool write_exactly(const int fd, const void * const data, const std::size_t size) noexcept {
+	return ::write(fd, data, size) == static_cast<ssize_t>(size);
+}
+
+class Connection {
+public:
+	// a source other than 0 is the address bound before the connect
+	Connection(const std::uint16_t port, SSL_CTX * const ssl_context, const in_addr_t source = 0) noexcept {
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		// the server may still be starting up
+		for(auto attempt = 0; attempt < connect_attempts && m_fd == -1; attempt++) {
+			m_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+			if(source) {
+				// the port is then picked at the connect, from a range of its own for every source and destination pair
+				const int enable = 1;
+				sockaddr_in source_address{};
+				source_address.sin_family = AF_INET;
+				source_address.sin_addr.s_addr = htonl(source);
+				::setsockopt(m_fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &enable, sizeof(enable));
+				::bind(m_fd, reinterpret_cast<const sockaddr *>(&source_address), sizeof(source_address));
+			}
+
+			if(::connect(m_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address))) {
+				::close(m_fd);
+				m_fd = -1;
+				std::this_thread::sleep_for(connect_retry_interval);
+			}
+		}
+
+		if(m_fd == -1) {
+			return;
+		}
+
+		const int enable = 1;
+		::setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+		if(ssl_context) {
+			m_ssl = SSL_new(ssl_context);
+			SSL_set_fd(m_ssl, m_fd);
+
+			if(SSL_connect(m_ssl) != 1) {
+				close();
+			}
+		}
+	}
+
+	Connection(const Connection & rhs) = delete;
+	Connection & operator=(const Connection & rhs) = delete;
+
+	~Connection() {
+		close();
+	}
+
+	bool open() const noexcept {
+		return m_fd != -1;
+	}
+
+	// sends count copies of the message and half-closes while reading the echo back, since the server stops reading
+	// once the echo it could not send yet passes its high watermark. the number of echoed bytes, or nothing on failure
+	std::optional<std::uint64_t> exchange(const std::vector<char> & message, std::uint64_t count, std::vector<char> & echo) noexcept {
+		std::uint64_t received = 0;
+		std::size_t offset = 0;
+		auto half_closed = false;
+		::fcntl(m_fd, F_SETFL, ::fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+
+		while(true) {
+			auto progressed = false;
+
+			if(count) {
+				const auto sent = transfer(true, const_cast<char *>(message.data()) + offset, message.size() - offset);
+
+				if(!sent || sent < would_block) {
+					return {};
+				} else if(sent > 0) {
+					progressed = true;
+					offset += static_cast<std::size_t>(sent);
+
+					if(offset == message.size()) {
+						offset = 0;
+						count--;
+					}
+				}
+			} else if(!half_closed) {
+				half_closed = m_ssl ? SSL_shutdown(m_ssl) >= 0 : !::shutdown(m_fd, SHUT_WR);
+				progressed = half_closed;
+			}
+
+			const auto bytes = transfer(false, echo.data(), echo.size());
+
+			if(!bytes) {
+				return count || !half_closed ? std::nullopt : std::optional(received);
+			} else if(bytes < would_block) {
+				return {};
+			} else if(bytes > 0) {
+				progressed = true;
+				received += static_cast<std::uint64_t>(bytes);
+			}
+
+			if(!progressed) {
+				pollfd events{m_fd, static_cast<short>(POLLIN | (count || !half_closed ? POLLOUT : 0)), 0};
+				::poll(&events, 1, -1);
+			}
+		}
+	}
+
+	// sends the message once and reads the whole of it back
+	bool round_trip(const std::vector<char> & message, std::vector<char> & echo) noexcept {
+		auto ok = open() && send(message.data(), message.size());
+
+		for(std::size_t received = 0; ok && received < message.size();) {
+			const auto bytes = receive(echo.data(), message.size() - received);
+			ok = bytes && std::equal(echo.data(), echo.data() + bytes, message.data() + received);
+			received += bytes;
+		}
+
+		return ok;
+	}
+
+	bool send(const char * data, std::size_t size) noexcept {
+
+		while(size) {
+			const auto sent = m_ssl ? SSL_write(m_ssl, data, static_cast<int>(size)) : ::send(m_fd, data, size, MSG_NOSIGNAL);
+
+			if(sent <= 0) {
+				return false;
+			}
+
+			data += sent;
+			size -= static_cast<std::size_t>(sent);
+		}
+
+		return true;
+	}
+
+	// 0 once the server has closed its side
+	std::size_t receive(char * const data, const std::size_t size) noexcept {
+		const auto received = m_ssl ? SSL_read(m_ssl, data, static_cast<int>(size)) : ::recv(m_fd, data, size, 0);
+		return received > 0 ? static_cast<std::size_t>(received) : 0;
+	}
+
+	void close() noexcept {
+
+		if(m_ssl) {
+			SSL_free(m_ssl);
+			m_ssl = nullptr;
+		}
+
+		if(m_fd != -1) {
+			::close(m_fd);
+			m_fd = -1;
+		}
+	}
+
+private:
+	static constexpr long would_block = -1;
+
+	// bytes moved, 0 once the peer has closed its side, would_block, or less on failure
+	long transfer(const bool sending, char * const data, const std::size_t size) noexcept {
+
+		if(m_ssl) {
+			const auto result = sending ? SSL_write(m_ssl, data, static_cast<int>(size)) : SSL_read(m_ssl, data, static_cast<int>(size));
+
+			if(result > 0) {
+				return result;
+			}
+
+			switch(SSL_get_error(m_ssl, result)) {
+				case SSL_ERROR_WANT_READ:
+				case SSL_ERROR_WANT_WRITE:
+					return would_block;
+				default:
+					// the server may close without a close_notify of its own
+					return 0;
+			}
+		}
+
+		const auto result = sending ? ::send(m_fd, data, size, MSG_NOSIGNAL) : ::recv(m_fd, data, size, 0);
+
+		if(result >= 0) {
+			return result;
+		}
+
+		return errno == EAGAIN || errno == EWOULDBLOCK ? would_block : would_block - 1;
+	}
+	///
+	int m_fd = -1;
+	SSL * m_ssl = nullptr;
+};
+
+Echo_client::Result summarize(std::vector<std::chrono::nanoseconds> & latencies) noexcept {
+	Echo_client::Result result;
+	result.ok = true;
+
+	if(!latencies.empty()) {
+		std::sort(latencies.begin(), latencies.end());
+		result.p50 = latencies[latencies.size() / 2];
+		result.p99 = latencies[latencies.size() * 99 / 100];
+		result.p999 = latencies[latencies.size() * 999 / 1000];
+	}
+
+	return result;
+}
+
+} // namespace
+
+Echo_client::Echo_client(const Options options) noexcept : m_options(options) {
+	int command_pipe[2];
+	int result_pipe[2];
+
+	if(::pipe(command_pipe) || ::pipe(result_pipe)) {
+		return;
+	}
+
+	m_child = ::fork();
+
+	if(!m_child) {
+		::close(command_pipe[1]);
+		::close(result_pipe[0]);
+		serve(command_pipe[0], result_pipe[1]);
+	}
+
+	::close(command_pipe[0]);
+	::close(result_pipe[1]);
+	m_command_fd = command_pipe[1];
+	m_result_fd = result_pipe[0];
+}
+
+Echo_client::~Echo_client() {
+
+	if(m_child <= 0) {
+		return;
+	}
+
+	const Command stop;
+	write_exactly(m_command_fd, &stop, sizeof(stop));
+	::close(m_command_fd);
+	::close(m_result_fd);
+	::waitpid(m_child, nullptr, 0);
+}
+
+Echo_client::Result Echo_client::run(const std::uint64_t messages) noexcept {
+	return request(false, messages);
+}
+
+Echo_client::Result Echo_client::hold_connections(const std::uint64_t connections) noexcept {
+	return request(true, connections);
+}
+
+Echo_client::Result Echo_client::request(const bool hold, const std::uint64_t count) noexcept {
+	const Command command{hold, count};
+	Result result;
+
+	if(m_child <= 0 || !count || !write_exactly(m_command_fd, &command, sizeof(command)) ||
+	   !read_exactly(m_result_fd, &result, sizeof(result))) {
+		return {};
+	}
+
+	return result;
+}
+
+void Echo_client::serve(const int command_fd, const int result_fd) const noexcept {
+	std::signal(SIGPIPE, SIG_IGN);
+
+	SSL_CTX * const ssl_context = m_options.tls ? SSL_CTX_new(TLS_client_method()) : nullptr;
+	SSL_CTX * const held_ssl_context = m_options.tls ? SSL_CTX_new(TLS_client_method()) : nullptr;
+	const std::vector<char> message(m_options.message_size, 'x');
+	std::vector<char> echo(std::max<std::size_t>(m_options.message_size, 64 * 1024));
+	std::vector<std::chrono::nanoseconds> latencies;
+	std::unique_ptr<Connection> streaming_connection;
+	std::vector<std::unique_ptr<Connection>> held_connections;
+	Command command;
+
+	// otherwise the client would hold two full records per connection, more than the server under test
+	if(held_ssl_context) {
+		SSL_CTX_set_mode(held_ssl_context, SSL_MODE_RELEASE_BUFFERS);
+	}
+
+	while(read_exactly(command_fd, &command, sizeof(command)) && command.count) {
+		auto ok = true;
+		latencies.clear();
+
+		if(command.hold) {
+
+			for(std::uint64_t i = 0; ok && i < command.count; i++) {
+				const auto source = INADDR_LOOPBACK + static_cast<in_addr_t>(held_connections.size() % source_addresses);
+				const auto started_at = std::chrono::steady_clock::now();
+				held_connections.push_back(std::make_unique<Connection>(m_options.port, held_ssl_context, source));
+				ok = held_connections.back()->round_trip(message, echo);
+				latencies.push_back(std::chrono::steady_clock::now() - started_at);
+			}
+		} else if(m_options.streaming) {
+
+			if(!streaming_connection) {
+				streaming_connection = std::make_unique<Connection>(m_options.port, ssl_context);
+			}
+
+			for(std::uint64_t i = 0; ok && i < command.count; i++) {
+				const auto sent_at = std::chrono::steady_clock::now();
+				ok = streaming_connection->round_trip(message, echo);
+				latencies.push_back(std::chrono::steady_clock::now() - sent_at);
+			}
+		} else {
+			const auto sent_at = std::chrono::steady_clock::now();
+			Connection connection(m_options.port, ssl_context);
+			const auto received = connection.open() ? connection.exchange(message, command.count, echo) : std::nullopt;
+			ok = received == command.count * message.size();
+			latencies.push_back(std::chrono::steady_clock::now() - sent_at);
+		}
+
+		auto result = ok ? summarize(latencies) : Result{};
+
+		if(!write_exactly(result_fd, &result, sizeof(result))) {
+			break;
+		}
+	}
+
+	// skips the destructors of everything the parent had set up before the fork
+	::_exit(0);
+}
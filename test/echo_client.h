@@ -0,0 +1,53 @@
+#ifndef ECHO_CLIENT_HXX
+#define ECHO_CLIENT_HXX
+
+#include <sys/types.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// drives echo traffic from a child process, so none of the client's own allocations or syscalls land in the counters
+// of the server under test. it has to be created before the server starts any thread
+class Echo_client {
+public:
+	struct Options {
+		std::uint16_t port = 1234;
+		bool tls = true;
+		// round trips over one connection kept across runs. otherwise every run opens a connection, sends all of its
+		// messages, half-closes and reads the whole echo back
+		bool streaming = true;
+		std::size_t message_size = 64;
+	};
+
+	struct Result {
+		bool ok = false;
+		// per round trip while streaming, for the whole run otherwise
+		std::chrono::nanoseconds p50{0};
+		std::chrono::nanoseconds p99{0};
+		std::chrono::nanoseconds p999{0};
+	};
+
+	explicit Echo_client(Options options) noexcept;
+	Echo_client(const Echo_client & rhs) = delete;
+	Echo_client(Echo_client && rhs) = delete;
+	Echo_client & operator=(const Echo_client & rhs) = delete;
+	Echo_client & operator=(Echo_client && rhs) = delete;
+	~Echo_client();
+
+	// blocks until the child has had this many messages echoed. the first run also waits for the server to listen
+	Result run(std::uint64_t messages) noexcept;
+	// opens this many more connections and keeps them all open, quiet after one echoed message each. the percentiles
+	// are per connection, from the connect to that first echo
+	Result hold_connections(std::uint64_t connections) noexcept;
+
+private:
+	Result request(bool hold, std::uint64_t count) noexcept;
+	[[noreturn]] void serve(int command_fd, int result_fd) const noexcept;
+	///
+	Options m_options;
+	pid_t m_child = -1;
+	int m_command_fd = -1;
+	int m_result_fd = -1;
+};
+
+#endif // ECHO_CLIENT_HXX
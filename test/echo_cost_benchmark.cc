@@ -0,0 +1,282 @@
+#include "allocation_counter.h"
+#include "echo_client.h"
+#include "syscall_counter.h"
+#include "test_certificate.h"
+#include "tcp_server.h"
+
+#include <openssl/crypto.h>
+#include <sys/resource.h>
+#include <dirent.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// what the server spends per echoed KiB: syscalls, global operator new calls and openssl allocations, and per echoed
+// message: session handler invocations and context switches of all its threads. n messages are echoed after a warm-up,
+// then ten times n, and only the difference is reported, so connection setup and the handshake drop out. connections=<n>
+// then opens n more connections that go quiet after one echo each, and reports the server's resident memory per
+// connection and the time from connect to that first echo. the cpu time the server burns while idle is measured last.
+// arguments are words: plain, buffered, uring, coroutine, sharded, compact, stage, size=<bytes>, messages=<n>,
+// threads=<n>, compute=<threads>, zerocopy=<threshold>, idle=<block|spin|poll>, spin=<us>, busy_poll=<us>,
+// connections=<n>
+namespace {
+
+std::atomic_uint64_t openssl_allocations{0};
+
+void * count_openssl_malloc(const std::size_t size, const char *, int) {
+	openssl_allocations.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size);
+}
+
+void * count_openssl_realloc(void * const pointer, const std::size_t size, const char *, int) {
+	openssl_allocations.fetch_add(1, std::memory_order_relaxed);
+	return std::realloc(pointer, size);
+}
+
+void free_openssl(void * const pointer, const char *, int) {
+	std::free(pointer);
+}
+
+// voluntary and involuntary ones, summed over every thread of the process
+std::uint64_t context_switches() noexcept {
+	std::uint64_t switches = 0;
+	auto * const tasks = opendir("/proc/self/task");
+
+	if(!tasks) {
+		return 0;
+	}
+
+	while(const auto * const task = readdir(tasks)) {
+
+		if(task->d_name[0] == '.') {
+			continue;
+		}
+
+		auto * const status = std::fopen(("/proc/self/task/" + std::string(task->d_name) + "/status").c_str(), "r");
+
+		if(!status) {
+			continue;
+		}
+
+		char line[256];
+
+		while(std::fgets(line, sizeof(line), status)) {
+			unsigned long long count = 0;
+
+			if(std::sscanf(line, "voluntary_ctxt_switches: %llu", &count) == 1 ||
+			   std::sscanf(line, "nonvoluntary_ctxt_switches: %llu", &count) == 1) {
+				switches += count;
+			}
+		}
+
+		std::fclose(status);
+	}
+
+	closedir(tasks);
+	return switches;
+}
+
+struct Totals {
+	std::uint64_t syscalls;
+	std::uint64_t operator_new_calls;
+	std::uint64_t openssl_allocations;
+	std::uint64_t handler_invocations;
+	std::uint64_t context_switches;
+};
+
+Totals totals() noexcept {
+	return {Syscall_counter::calls(), Allocation_counter::operator_new_calls(), openssl_allocations.load(std::memory_order_relaxed),
+		  Handler_memory::invocations(), context_switches()};
+}
+
+// VmRSS of the whole process. 0 if /proc could not tell
+std::uint64_t resident_bytes() noexcept {
+	auto * const status = std::fopen("/proc/self/status", "r");
+
+	if(!status) {
+		return 0;
+	}
+
+	char line[256];
+	unsigned long long kib = 0;
+
+	while(std::fgets(line, sizeof(line), status) && std::sscanf(line, "VmRSS: %llu kB", &kib) != 1) {
+	}
+
+	std::fclose(status);
+	return kib * 1024;
+}
+
+std::chrono::microseconds cpu_time() noexcept {
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+	const auto to_microseconds = [](const timeval & time) { return std::chrono::seconds(time.tv_sec) + std::chrono::microseconds(time.tv_usec); };
+	return to_microseconds(usage.ru_utime) + to_microseconds(usage.ru_stime);
+}
+
+bool starts_with(const char * const argument, const char * const prefix) noexcept {
+	return !std::strncmp(argument, prefix, std::strlen(prefix));
+}
+
+} // namespace
+
+int main(const int argc, const char * const argv[]) {
+
+	// before the first openssl allocation
+	if(!CRYPTO_set_mem_functions(count_openssl_malloc, count_openssl_realloc, free_openssl)) {
+		return 1;
+	}
+
+	Server_options options;
+	options.echo_mode = Echo_mode::streaming;
+	std::size_t message_size = 1024;
+	std::uint64_t messages = 2000;
+	std::size_t worker_threads = 1;
+	std::uint64_t held_connections = 0;
+
+	for(int i = 1; i < argc; ++i) {
+		const auto * const argument = argv[i];
+
+		if(!std::strcmp(argument, "plain")) {
+			options.transport = Transport::plaintext;
+		} else if(!std::strcmp(argument, "buffered")) {
+			options.echo_mode = Echo_mode::buffered;
+		} else if(!std::strcmp(argument, "uring")) {
+			options.io_backend = Io_backend::io_uring;
+		} else if(!std::strcmp(argument, "coroutine")) {
+			options.lifecycle = Lifecycle::coroutine;
+		} else if(!std::strcmp(argument, "sharded")) {
+			options.threading = Threading::sharded;
+		} else if(!std::strcmp(argument, "compact")) {
+			options.compact_tls = true;
+		} else if(!std::strcmp(argument, "stage")) {
+			// keeps plaintext streaming on the session instead of splice
+			options.message_stage = [](Buffer_pool::Buffer &) {};
+		} else if(starts_with(argument, "compute=")) {
+			options.compute_threads = std::strtoull(argument + 8, nullptr, 10);
+		} else if(starts_with(argument, "zerocopy=")) {
+			options.zerocopy_threshold = std::strtoull(argument + 9, nullptr, 10);
+		} else if(!std::strcmp(argument, "idle=block")) {
+			options.idle_strategy = Idle_strategy::block;
+		} else if(!std::strcmp(argument, "idle=spin")) {
+			options.idle_strategy = Idle_strategy::spin_then_block;
+		} else if(!std::strcmp(argument, "idle=poll")) {
+			options.idle_strategy = Idle_strategy::busy_poll;
+		} else if(starts_with(argument, "spin=")) {
+			options.idle_spin = std::chrono::microseconds(std::strtoull(argument + 5, nullptr, 10));
+		} else if(starts_with(argument, "busy_poll=")) {
+			options.socket_busy_poll = std::chrono::microseconds(std::strtoull(argument + 10, nullptr, 10));
+		} else if(starts_with(argument, "size=")) {
+			message_size = std::strtoull(argument + 5, nullptr, 10);
+		} else if(starts_with(argument, "messages=")) {
+			messages = std::strtoull(argument + 9, nullptr, 10);
+		} else if(starts_with(argument, "threads=")) {
+			worker_threads = std::strtoull(argument + 8, nullptr, 10);
+		} else if(starts_with(argument, "connections=")) {
+			held_connections = std::strtoull(argument + 12, nullptr, 10);
+		} else {
+			std::fprintf(stderr, "unknown argument %s\n", argument);
+			return 1;
+		}
+	}
+
+	const auto auth_dir = Test_certificate::create();
+
+	if(auth_dir.empty()) {
+		std::fprintf(stderr, "could not create a test certificate\n");
+		return 1;
+	}
+
+	// the server logs every echo
+	if(!std::freopen("/dev/null", "w", stdout)) {
+		return 1;
+	}
+
+	if(held_connections) {
+		// the streaming connection is held as well
+		options.max_connections = std::max<std::size_t>(options.max_connections, held_connections + 1);
+
+		// before the fork, so the client gets as many descriptors as the server
+		rlimit descriptors{};
+
+		if(!getrlimit(RLIMIT_NOFILE, &descriptors)) {
+			descriptors.rlim_cur = descriptors.rlim_max;
+			setrlimit(RLIMIT_NOFILE, &descriptors);
+		}
+	}
+
+	constexpr std::uint16_t port = 24200;
+	const auto streaming = options.echo_mode == Echo_mode::streaming;
+	Echo_client client({port, options.transport == Transport::tls, streaming, message_size});
+	// this thread only talks to the client's pipes
+	Syscall_counter::ignore_current_thread();
+	Tcp_server server(worker_threads, port, auth_dir, options);
+	server.start();
+
+	if(!client.run(messages).ok) {
+		std::fprintf(stderr, "warm-up echoes failed\n");
+		return 1;
+	}
+
+	const auto before = totals();
+	const auto short_run = client.run(messages);
+	const auto between = totals();
+	const auto long_run = client.run(messages * 10);
+	const auto after = totals();
+
+	if(!short_run.ok || !long_run.ok) {
+		std::fprintf(stderr, "echoes failed\n");
+		return 1;
+	}
+
+	const auto per_message = [&](const std::uint64_t Totals::*total) {
+		const auto long_cost = static_cast<double>(after.*total - between.*total);
+		const auto short_cost = static_cast<double>(between.*total - before.*total);
+		return (long_cost - short_cost) / static_cast<double>(messages * 9);
+	};
+
+	const auto per_kib = [&](const std::uint64_t Totals::*total) {
+		return per_message(total) * 1024 / static_cast<double>(message_size);
+	};
+
+	std::fprintf(stderr, "%zu byte messages, per echoed KiB: %.3f syscalls, %.3f operator new calls, %.3f openssl allocations\n",
+			 message_size, per_kib(&Totals::syscalls), per_kib(&Totals::operator_new_calls), per_kib(&Totals::openssl_allocations));
+	std::fprintf(stderr, "per echoed message: %.3f handler invocations, %.3f context switches\n", per_message(&Totals::handler_invocations),
+			 per_message(&Totals::context_switches));
+
+	if(streaming) {
+		std::fprintf(stderr, "round trip p50 %lld ns, p99 %lld ns, p999 %lld ns\n", static_cast<long long>(long_run.p50.count()),
+				 static_cast<long long>(long_run.p99.count()), static_cast<long long>(long_run.p999.count()));
+	}
+
+	if(held_connections) {
+		const auto resident_before = resident_bytes();
+		const auto held = client.hold_connections(held_connections);
+		const auto resident_after = resident_bytes();
+
+		if(!held.ok) {
+			std::fprintf(stderr, "holding %llu connections failed\n", static_cast<unsigned long long>(held_connections));
+			return 1;
+		}
+
+		std::fprintf(stderr, "%llu idle connections, %.0f bytes of server rss each\n", static_cast<unsigned long long>(held_connections),
+				 (static_cast<double>(resident_after) - static_cast<double>(resident_before)) / static_cast<double>(held_connections));
+		std::fprintf(stderr, "connect to first echo p50 %lld ns, p99 %lld ns, p999 %lld ns\n", static_cast<long long>(held.p50.count()),
+				 static_cast<long long>(held.p99.count()), static_cast<long long>(held.p999.count()));
+	}
+
+	// every connection stays open but quiet. only the idle strategy keeps the workers busy now
+	constexpr auto idle_period = std::chrono::seconds(1);
+	const auto idle_start = cpu_time();
+	std::this_thread::sleep_for(idle_period);
+	const auto idle_cpu = cpu_time() - idle_start;
+
+	std::fprintf(stderr, "idle cpu %.1f%% of a core\n",
+			 100.0 * static_cast<double>(idle_cpu.count()) / static_cast<double>(std::chrono::microseconds(idle_period).count()));
+	return 0;
+}
@@ -0,0 +1,115 @@
+#include "allocation_counter.h"
+#include "echo_client.h"
+#include "test_certificate.h"
+#include "tcp_server.h"
+
+#include <cstdio>
+#include <string>
+#include <utility>
+
+// steady-state echo has to stay off the global operator new. a connection is warmed up first, then the calls made over
+// n echoes are compared with those made over ten times as many. anything a single echo allocates shows up tenfold.
+// every io_context here is run by a single worker. see Handler_memory for what several workers on one of them cost
+namespace {
+
+constexpr std::uint64_t warm_up_echoes = 500;
+constexpr std::uint64_t echoes = 500;
+
+struct Scenario {
+	std::string name;
+	std::uint16_t port;
+	std::size_t worker_threads;
+	Server_options options;
+};
+
+bool run(const Scenario & scenario, const std::string & auth_dir) {
+	Echo_client client({scenario.port, scenario.options.transport == Transport::tls, true, 64});
+	Tcp_server server(scenario.worker_threads, scenario.port, auth_dir, scenario.options);
+	server.start();
+
+	if(!client.run(warm_up_echoes).ok) {
+		std::fprintf(stderr, "%s : warm-up echoes failed\n", scenario.name.c_str());
+		return false;
+	}
+
+	const auto before = Allocation_counter::operator_new_calls();
+	const auto short_run = client.run(echoes);
+	const auto between = Allocation_counter::operator_new_calls();
+	const auto long_run = client.run(echoes * 10);
+	const auto after = Allocation_counter::operator_new_calls();
+
+	if(!short_run.ok || !long_run.ok) {
+		std::fprintf(stderr, "%s : echoes failed\n", scenario.name.c_str());
+		return false;
+	}
+
+	const auto short_calls = between - before;
+	const auto long_calls = after - between;
+	const auto passed = long_calls <= short_calls;
+
+	std::fprintf(stderr, "%s %s : %llu operator new calls for %llu echoes, %llu for %llu\n", passed ? "pass" : "FAIL", scenario.name.c_str(),
+			 static_cast<unsigned long long>(short_calls), static_cast<unsigned long long>(echoes),
+			 static_cast<unsigned long long>(long_calls), static_cast<unsigned long long>(echoes * 10));
+	return passed;
+}
+
+} // namespace
+
+int main() {
+	const auto auth_dir = Test_certificate::create();
+
+	if(auth_dir.empty()) {
+		std::fprintf(stderr, "could not create a test certificate\n");
+		return 1;
+	}
+
+	// the server logs every echo
+	if(!std::freopen("/dev/null", "w", stdout)) {
+		return 1;
+	}
+
+	Server_options tls;
+	tls.echo_mode = Echo_mode::streaming;
+
+	Server_options compact_tls = tls;
+	compact_tls.compact_tls = true;
+
+	Server_options plaintext = tls;
+	plaintext.transport = Transport::plaintext;
+
+	// a message stage keeps plaintext streaming on the session instead of splice
+	Server_options staged_plaintext = plaintext;
+	staged_plaintext.message_stage = [](Buffer_pool::Buffer &) {};
+
+#if defined(ASIO_HAS_CO_AWAIT)
+	Server_options coroutine_tls = tls;
+	coroutine_tls.lifecycle = Lifecycle::coroutine;
+
+	Server_options coroutine_plaintext = plaintext;
+	coroutine_plaintext.lifecycle = Lifecycle::coroutine;
+#endif
+
+	const std::pair<const char *, Server_options> transports[] = {
+		{"asio tls", tls},
+		{"socket bound tls", compact_tls},
+		{"plaintext splice", plaintext},
+		{"plaintext session", staged_plaintext},
+#if defined(ASIO_HAS_CO_AWAIT)
+		{"coroutine tls", coroutine_tls},
+		{"coroutine plaintext", coroutine_plaintext},
+#endif
+	};
+
+	std::uint16_t port = 24100;
+	auto passed = true;
+
+	for(const auto & [name, options] : transports) {
+		auto sharded = options;
+		sharded.threading = Threading::sharded;
+
+		passed = run({std::string(name) + ", one worker", port++, 1, options}, auth_dir) && passed;
+		passed = run({std::string(name) + ", sharded", port++, 2, sharded}, auth_dir) && passed;
+	}
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+#include "slot_map.h"
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// the id guarantees Tcp_server's admission leans on. a released id is dead for good, capacity ids can always be held
+// at once, and no slot is handed to two threads
+namespace {
+
+bool report(const bool passed, const char * name) {
+	std::fprintf(stderr, "%s %s\n", passed ? "pass" : "FAIL", name);
+	return passed;
+}
+
+bool stale_ids() {
+	Slot_map slots(4, 1);
+	const auto id = slots.acquire(0);
+
+	if(!id || !slots.contains(*id)) {
+		return report(false, "stale ids : a fresh id is not contained");
+	}
+
+	slots.release(*id, 0);
+	// the local free list hands the very same slot out again, under its next generation
+	const auto reused = slots.acquire(0);
+	slots.release(*id, 0);
+
+	const auto passed = !slots.contains(*id) && reused && *reused != *id && slots.contains(*reused) && !slots.contains(~0ULL);
+	return report(passed, "stale ids : a released id matches nothing and releasing it again leaves the slot's next owner alone");
+}
+
+bool capacity_with_parked_slots() {
+	constexpr std::size_t capacity = 256;
+	constexpr std::size_t parked = 64; // what a local free list keeps before it spills into the shared stack
+	Slot_map slots(capacity, 2);
+	std::vector<std::uint64_t> ids;
+
+	for(std::size_t i = 0; i < capacity; i++) {
+		if(const auto id = slots.acquire(Slot_map::shared_free_list)) {
+			ids.push_back(*id);
+		}
+	}
+
+	// both threads' free lists fill up and keep their slots out of everybody else's reach
+	for(std::size_t i = 0; i < parked * 2; i++) {
+		slots.release(ids.back(), i % 2);
+		ids.pop_back();
+	}
+
+	for(std::size_t i = 0; i < parked * 2; i++) {
+		if(const auto id = slots.acquire(Slot_map::shared_free_list)) {
+			ids.push_back(*id);
+		}
+	}
+
+	const auto held = ids.size();
+	const auto beyond = slots.acquire(Slot_map::shared_free_list);
+
+	std::fprintf(stderr, "  %zu of %zu ids held while %zu slots sit on other free lists\n", held, capacity, parked * 2);
+	return report(held == capacity && !beyond, "capacity : exactly capacity ids are reachable whatever the free lists hold");
+}
+
+bool concurrent_threads() {
+	constexpr std::size_t threads = 4;
+	constexpr std::size_t held_per_thread = 32;
+	constexpr std::size_t rounds = 20000;
+	Slot_map slots(threads * held_per_thread, threads);
+	// taken flags per slot index. a slot handed out twice finds its flag already set
+	const auto slot_count = threads * held_per_thread + 64 * threads;
+	std::unique_ptr<std::atomic_bool[]> taken(new std::atomic_bool[slot_count]);
+
+	for(std::size_t i = 0; i < slot_count; i++) {
+		taken[i] = false;
+	}
+
+	std::atomic_bool passed = true;
+	std::vector<std::thread> workers;
+
+	for(std::size_t thread = 0; thread < threads; thread++) {
+		// the last thread has no free list of its own and goes through the shared stack only
+		const auto free_list = thread + 1 == threads ? Slot_map::shared_free_list : thread;
+
+		workers.emplace_back([&, free_list, thread] {
+			std::vector<std::uint64_t> ids;
+
+			for(std::size_t round = 0; round < rounds; round++) {
+
+				if(ids.size() < held_per_thread && (ids.empty() || (round + thread) % 3)) {
+					const auto id = slots.acquire(free_list);
+
+					if(!id || !slots.contains(*id) || taken[static_cast<std::uint32_t>(*id)].exchange(true)) {
+						passed = false;
+						return;
+					}
+
+					ids.push_back(*id);
+				} else {
+					taken[static_cast<std::uint32_t>(ids.back())] = false;
+					slots.release(ids.back(), free_list);
+
+					if(slots.contains(ids.back())) {
+						passed = false;
+						return;
+					}
+
+					ids.pop_back();
+				}
+			}
+		});
+	}
+
+	for(auto & worker : workers) {
+		worker.join();
+	}
+
+	return report(passed, "concurrency : threads acquiring and releasing at once never share a slot");
+}
+
+} // namespace
+
+int main() {
+	auto passed = stale_ids();
+	passed = capacity_with_parked_slots() && passed;
+	passed = concurrent_threads() && passed;
+	return passed ? 0 : 1;
+}
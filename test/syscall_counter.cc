@@ -0,0 +1,73 @@
+#include "syscall_counter.h"
+
+#include <dlfcn.h>
+#include <atomic>
+#include <cstdarg>
+
+// the wrappers are declared here rather than taken from the system headers, which declare some of them noexcept and
+// some not. only the symbol names matter to the linker
+namespace {
+
+std::atomic_uint64_t syscalls{0};
+thread_local bool ignored = false;
+
+template <typename function_type>
+function_type * next_definition(const char * const name) noexcept {
+	return reinterpret_cast<function_type *>(::dlsym(RTLD_NEXT, name));
+}
+
+void count_call() noexcept {
+
+	if(!ignored) {
+		syscalls.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+} // namespace
+
+std::uint64_t Syscall_counter::calls() noexcept {
+	return syscalls.load(std::memory_order_relaxed);
+}
+
+void Syscall_counter::ignore_current_thread() noexcept {
+	ignored = true;
+}
+
+#define COUNTED_WRAPPER(return_type, name, parameters, arguments)                                                       \
+	extern "C" return_type name parameters {                                                                        \
+		static auto * const next = next_definition<return_type parameters>(#name);                              \
+		count_call();                                                                                           \
+		return next arguments;                                                                                  \
+	}
+
+COUNTED_WRAPPER(long, read, (int fd, void * data, unsigned long size), (fd, data, size))
+COUNTED_WRAPPER(long, write, (int fd, const void * data, unsigned long size), (fd, data, size))
+COUNTED_WRAPPER(long, readv, (int fd, const void * buffers, int count), (fd, buffers, count))
+COUNTED_WRAPPER(long, writev, (int fd, const void * buffers, int count), (fd, buffers, count))
+COUNTED_WRAPPER(long, recv, (int fd, void * data, unsigned long size, int flags), (fd, data, size, flags))
+COUNTED_WRAPPER(long, send, (int fd, const void * data, unsigned long size, int flags), (fd, data, size, flags))
+COUNTED_WRAPPER(long, recvmsg, (int fd, void * message, int flags), (fd, message, flags))
+COUNTED_WRAPPER(long, sendmsg, (int fd, const void * message, int flags), (fd, message, flags))
+COUNTED_WRAPPER(long, splice, (int in, void * in_offset, int out, void * out_offset, unsigned long size, unsigned flags),
+		    (in, in_offset, out, out_offset, size, flags))
+COUNTED_WRAPPER(int, epoll_wait, (int epoll_fd, void * events, int max_events, int timeout), (epoll_fd, events, max_events, timeout))
+COUNTED_WRAPPER(int, epoll_ctl, (int epoll_fd, int operation, int fd, void * event), (epoll_fd, operation, fd, event))
+COUNTED_WRAPPER(int, setsockopt, (int fd, int level, int name, const void * value, unsigned length), (fd, level, name, value, length))
+COUNTED_WRAPPER(int, getsockopt, (int fd, int level, int name, void * value, unsigned * length), (fd, level, name, value, length))
+COUNTED_WRAPPER(int, ioctl, (int fd, unsigned long request, void * argument), (fd, request, argument))
+
+// io_uring_enter has no libc wrapper. the backend reaches it through syscall(2)
+extern "C" long syscall(long number, ...) {
+	static auto * const next = next_definition<long(long, ...)>("syscall");
+	long arguments[6];
+	va_list list;
+	va_start(list, number);
+
+	for(auto & argument : arguments) {
+		argument = va_arg(list, long);
+	}
+
+	va_end(list);
+	count_call();
+	return next(number, arguments[0], arguments[1], arguments[2], arguments[3], arguments[4], arguments[5]);
+}
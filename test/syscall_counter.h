@@ -0,0 +1,15 @@
+#ifndef SYSCALL_COUNTER_HXX
+#define SYSCALL_COUNTER_HXX
+
+#include <cstdint>
+
+// counts the socket, event and pipe syscalls the process makes through libc. linking syscall_counter.cc interposes the
+// wrappers, so a direct syscall instruction or libc's own stdio writes go uncounted
+class Syscall_counter {
+public:
+	static std::uint64_t calls() noexcept;
+	// calls of the calling thread are left out from now on, such as those of a benchmark driving the server
+	static void ignore_current_thread() noexcept;
+};
+
+#endif // SYSCALL_COUNTER_HXX
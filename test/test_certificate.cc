@@ -0,0 +1,76 @@
+#include "test_certificate.h"
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+#include <cstdlib>
+#include <cstdio>
+#include <memory>
+
+namespace {
+
+template <typename value_type, void (*free_function)(value_type *)>
+struct Openssl_deleter {
+	void operator()(value_type * value) const noexcept { free_function(value); }
+};
+
+using Pkey_context = std::unique_ptr<EVP_PKEY_CTX, Openssl_deleter<EVP_PKEY_CTX, EVP_PKEY_CTX_free>>;
+using Pkey = std::unique_ptr<EVP_PKEY, Openssl_deleter<EVP_PKEY, EVP_PKEY_free>>;
+using Certificate = std::unique_ptr<X509, Openssl_deleter<X509, X509_free>>;
+
+bool write_pem(const std::string & path, const EVP_PKEY * key, X509 * certificate) noexcept {
+	std::unique_ptr<FILE, int (*)(FILE *)> file(std::fopen(path.c_str(), "w"), std::fclose);
+
+	if(!file) {
+		return false;
+	}
+
+	return certificate ? PEM_write_X509(file.get(), certificate) : PEM_write_PrivateKey(file.get(), key, nullptr, nullptr, 0, nullptr, nullptr);
+}
+
+} // namespace
+
+std::string Test_certificate::create() noexcept {
+	char directory_template[] = "/tmp/tcpserver_test_XXXXXX";
+
+	if(!::mkdtemp(directory_template)) {
+		return {};
+	}
+
+	const std::string directory = std::string(directory_template) + '/';
+	Pkey_context key_context(EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr));
+	EVP_PKEY * generated_key = nullptr;
+
+	if(!key_context || EVP_PKEY_keygen_init(key_context.get()) != 1 ||
+	   EVP_PKEY_CTX_set_rsa_keygen_bits(key_context.get(), 2048) != 1 || EVP_PKEY_keygen(key_context.get(), &generated_key) != 1) {
+		return {};
+	}
+
+	const Pkey key(generated_key);
+	const Certificate certificate(X509_new());
+
+	if(!certificate) {
+		return {};
+	}
+
+	X509_set_version(certificate.get(), 2);
+	ASN1_INTEGER_set(X509_get_serialNumber(certificate.get()), 1);
+	X509_gmtime_adj(X509_getm_notBefore(certificate.get()), 0);
+	X509_gmtime_adj(X509_getm_notAfter(certificate.get()), 24 * 60 * 60);
+	X509_set_pubkey(certificate.get(), key.get());
+
+	auto * const name = X509_get_subject_name(certificate.get());
+	X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+	X509_set_issuer_name(certificate.get(), name);
+
+	if(!X509_sign(certificate.get(), key.get(), EVP_sha256())) {
+		return {};
+	}
+
+	if(!write_pem(directory + "certificate.pem", nullptr, certificate.get()) || !write_pem(directory + "private_key.pem", key.get(), nullptr)) {
+		return {};
+	}
+
+	return directory;
+}
@@ -0,0 +1,13 @@
+#ifndef TEST_CERTIFICATE_HXX
+#define TEST_CERTIFICATE_HXX
+
+#include <string>
+
+// a throwaway self-signed certificate, so a tls test needs no generate_certs.sh run beforehand
+class Test_certificate {
+public:
+	// the directory holding certificate.pem and private_key.pem, with a trailing slash. empty on failure
+	static std::string create() noexcept;
+};
+
+#endif // TEST_CERTIFICATE_HXX
@@ -0,0 +1,57 @@
+#include "token_bucket.h"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+// the accept rate limit. a burst goes through at once, then the rate decides
+namespace {
+
+bool report(const bool passed, const char * name) {
+	std::fprintf(stderr, "%s %s\n", passed ? "pass" : "FAIL", name);
+	return passed;
+}
+
+int take_all(Token_bucket & bucket, const int attempts) {
+	auto taken = 0;
+
+	for(auto i = 0; i < attempts; i++) {
+		taken += bucket.try_take();
+	}
+
+	return taken;
+}
+
+bool unlimited() {
+	Token_bucket bucket(0, 1);
+	return report(take_all(bucket, 100000) == 100000, "rate 0 : everything is admitted");
+}
+
+bool burst() {
+	// slow enough that no token comes back while the burst is taken
+	Token_bucket bucket(0.001, 10);
+	const auto taken = take_all(bucket, 100);
+	std::fprintf(stderr, "  %d of 100 taken with a burst of 10\n", taken);
+	return report(taken == 10, "burst : a full bucket admits its burst and nothing beyond");
+}
+
+bool refill() {
+	Token_bucket bucket(100, 5);
+	take_all(bucket, 5);
+	const auto empty = !bucket.try_take();
+
+	// 100 ms at 100 a second is 10 tokens, capped at the burst of 5
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	const auto taken = take_all(bucket, 100);
+	std::fprintf(stderr, "  %d taken after 100 ms at 100 a second with a burst of 5\n", taken);
+	return report(empty && taken == 5, "refill : tokens come back at the rate, up to the burst");
+}
+
+} // namespace
+
+int main() {
+	auto passed = unlimited();
+	passed = burst() && passed;
+	passed = refill() && passed;
+	return passed ? 0 : 1;
+}